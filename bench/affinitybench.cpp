@@ -0,0 +1,214 @@
+/*
+按连接分派(SubmitTo)的基准测试，与所有任务进共享队列(submit)对比：
+- pool：每个键带一块状态，每个任务把自己键的状态读写一遍，事件循环式地每轮给每个键提交一个任务；
+  统计每秒任务数，以及同一个键的任务换了线程的比例(换线程意味着状态要从别的CPU的缓存里取)；
+- http：每个连接一对socketpair，每轮给每个连接写入一个请求，任务在线程池里读取、process、写出响应，主线程收完全部响应；
+  分别请求小页面(index.html)与大文件；两个文件放在/tmp下临时创建的资源目录里，大文件在运行时生成，不写进源码树，退出时删除；
+- 单CPU上没有跨核的缓存迁移，这里只能看到定向唤醒的开销，多核机器上才能看到按连接分派的收益；
+用法：./affinitybench [键(连接)数] [轮数] [大文件MB] [所属队列深度]
+*/
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/threadpool/threadpool.h"
+#include "../src/http/httpconn.h"
+#include "bench.h"
+
+static const size_t WORKERS = 4;
+static thread_local int workerId = -1;  // 线程池的线程编号，由ThreadInit设置
+static std::string tmpDir;              // 临时的资源目录，退出时删除
+
+/**
+ * @brief 一次运行的结果；
+ */
+struct AffinityResult {
+    double perSec = 0;      // 每秒任务(请求)数
+    double movedPct = 0;    // 同一个键的任务换了线程的比例
+};
+
+/**
+ * @brief 记录键最近一次在哪个线程上执行，返回是否换了线程；
+ */
+static bool Moved(std::vector<int>& last, int key) {
+    bool moved = last[key] >= 0 && last[key] != workerId;
+    last[key] = workerId;
+    return moved;
+}
+
+static ThreadPool::ThreadInit SetWorkerId() {
+    return [](size_t id) { workerId = static_cast<int>(id); };
+}
+
+/**
+ * @brief 线程池本身：每个键一块stateKB大小的状态；
+ * @param depth 0为共享队列，大于0为SubmitTo的所属队列深度；
+ */
+static AffinityResult RunPool(int keys, int rounds, size_t stateKB, size_t depth) {
+    std::vector<std::vector<char>> state(keys, std::vector<char>(stateKB * 1024, 1));
+    std::vector<int> last(keys, -1);
+    std::atomic<long> moved{0}, sum{0};
+    int64_t start = BenchNowNS();
+    {
+        ThreadPool pool(WORKERS, ThreadPool::QUEUE_CAPACITY, SetWorkerId());
+        for(int r = 0; r < rounds; r++) {
+            std::atomic<int> pending{keys};
+            {
+                ThreadPool::Batch batch(&pool);
+                for(int k = 0; k < keys; k++) {
+                    auto task = [&, k]() {
+                        long s = 0;
+                        for(size_t i = 0; i < state[k].size(); i += 64) { s += state[k][i]++; }
+                        sum.fetch_add(s, std::memory_order_relaxed);
+                        if(Moved(last, k)) { moved.fetch_add(1, std::memory_order_relaxed); }
+                        pending.fetch_sub(1, std::memory_order_release);
+                    };
+                    if(depth > 0) { pool.SubmitTo(k, depth, task); } else { pool.submit(task); }
+                }
+            }
+            while(pending.load(std::memory_order_acquire) > 0) { std::this_thread::yield(); }
+        }
+    }
+    double secs = static_cast<double>(BenchNowNS() - start) / 1e9;
+    long total = static_cast<long>(keys) * rounds;
+    return { total / secs, 100.0 * moved.load() / total };
+}
+
+/**
+ * @brief 连接在线程池里读取请求、处理并写出响应，主线程作为对端收完全部响应；
+ * @param path 请求的资源；
+ */
+static AffinityResult RunHttp(int conns, int rounds, const char* path, size_t depth) {
+    std::vector<HttpConn> server(conns);
+    std::vector<int> client(conns);
+    for(int c = 0; c < conns; c++) {
+        int fds[2];
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) { perror("socketpair"); exit(1); }
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        sockaddr_in addr = {};
+        server[c].init(fds[0], addr);
+        client[c] = fds[1];
+    }
+    std::string req = std::string("GET ") + path + " HTTP/1.1\r\nHost: bench\r\nConnection: keep-alive\r\n\r\n";
+    HttpConn::IoFunc reader = HttpConn::Reader(true);
+    HttpConn::IoFunc writer = HttpConn::Writer(true);
+    std::vector<int> last(conns, -1);
+    std::vector<std::atomic<size_t>> want(conns);   // 本轮响应的长度，任务处理完请求后填入
+    std::vector<size_t> got(conns);
+    std::vector<pollfd> pfds(conns);
+    std::vector<char> scratch(1 << 20);
+    std::atomic<long> moved{0};
+    int64_t start = BenchNowNS();
+    {
+        ThreadPool pool(WORKERS, ThreadPool::QUEUE_CAPACITY, SetWorkerId());
+        for(int r = 0; r < rounds; r++) {
+            std::atomic<int> pending{conns};
+            {
+                ThreadPool::Batch batch(&pool);
+                for(int c = 0; c < conns; c++) {
+                    want[c].store(0, std::memory_order_relaxed);
+                    got[c] = 0;
+                    if(::write(client[c], req.data(), req.size()) != static_cast<ssize_t>(req.size())) { perror("write"); exit(1); }
+                    auto task = [&, c]() {
+                        int err = 0;
+                        (server[c].*reader)(&err);
+                        if(!server[c].process()) { fprintf(stderr, "process failed\n"); exit(1); }
+                        want[c].store(server[c].ToWriteBytes(), std::memory_order_release);
+                        while(server[c].ToWriteBytes() > 0) {
+                            if((server[c].*writer)(&err) < 0 && err == EAGAIN) { sched_yield(); }   // 等主线程收走
+                        }
+                        if(Moved(last, c)) { moved.fetch_add(1, std::memory_order_relaxed); }
+                        pending.fetch_sub(1, std::memory_order_release);
+                    };
+                    if(depth > 0) { pool.SubmitTo(c, depth, task); } else { pool.submit(task); }
+                }
+            }
+            int left = conns;
+            while(left > 0) {
+                for(int c = 0; c < conns; c++) { pfds[c] = { client[c], POLLIN, 0 }; }
+                poll(pfds.data(), conns, 1);
+                for(int c = 0; c < conns; c++) {
+                    if(!(pfds[c].revents & POLLIN)) { continue; }
+                    ssize_t len = ::read(client[c], scratch.data(), scratch.size());
+                    if(len <= 0) { perror("read"); exit(1); }
+                    got[c] += len;
+                    size_t w = want[c].load(std::memory_order_acquire);
+                    if(w > 0 && got[c] == w) { left--; }
+                }
+            }
+            while(pending.load(std::memory_order_acquire) > 0) { std::this_thread::yield(); }
+        }
+    }
+    double secs = static_cast<double>(BenchNowNS() - start) / 1e9;
+    for(int c = 0; c < conns; c++) {
+        server[c].Close();
+        close(client[c]);
+    }
+    long total = static_cast<long>(conns) * rounds;
+    return { total / secs, 100.0 * moved.load() / total };
+}
+
+/**
+ * @brief 在/tmp下创建临时的资源目录：复制index.html，生成mb兆的big.bin；
+ * @return 资源目录，以'/'结尾；
+ */
+static std::string MakeResources(size_t mb) {
+    char dir[] = "/tmp/affinitybench.XXXXXX";
+    if(!mkdtemp(dir)) { perror("mkdtemp"); exit(1); }
+    tmpDir = dir;
+    atexit([]() {
+        unlink((tmpDir + "/index.html").c_str());
+        unlink((tmpDir + "/big.bin").c_str());
+        rmdir(tmpDir.c_str());
+    });
+    FILE* src = fopen(RESOURCES_DIR "index.html", "rb");
+    FILE* index = fopen((tmpDir + "/index.html").c_str(), "wb");
+    FILE* big = fopen((tmpDir + "/big.bin").c_str(), "wb");
+    if(!src || !index || !big) { perror("fopen"); exit(1); }
+    std::vector<char> chunk(1 << 20, 'x');
+    size_t len;
+    while((len = fread(chunk.data(), 1, chunk.size(), src)) > 0) { fwrite(chunk.data(), 1, len, index); }
+    std::fill(chunk.begin(), chunk.end(), 'x');
+    for(size_t i = 0; i < mb; i++) {
+        if(fwrite(chunk.data(), 1, chunk.size(), big) != chunk.size()) { perror("fwrite"); exit(1); }
+    }
+    fclose(src);
+    fclose(index);
+    fclose(big);
+    return tmpDir + "/";
+}
+
+static void PrintRow(const char* name, const AffinityResult& shared, const AffinityResult& affine) {
+    printf("%-24s %12.0f %8.1f%% %12.0f %8.1f%%\n", name,
+           shared.perSec, shared.movedPct, affine.perSec, affine.movedPct);
+}
+
+int main(int argc, char* argv[]) {
+    int keys = argc > 1 ? atoi(argv[1]) : 64;
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    size_t bigMB = argc > 3 ? atoi(argv[3]) : 1;
+    size_t depth = argc > 4 ? atoi(argv[4]) : 32;
+    std::string resources = MakeResources(bigMB);
+    HttpConn::srcDir = resources.c_str();
+    HttpConn::SetPhaseTimeouts(60000, 60000, 60000, 60000);
+    printf("%d keys, %d rounds, %zu workers, depth %zu, %u CPUs\n",
+           keys, rounds, WORKERS, depth, std::thread::hardware_concurrency());
+    printf("%-24s %12s %9s %12s %9s\n", "", "shared/s", "moved", "affine/s", "moved");
+    for(int round = 0; round < 2; round++) {    // 第一轮包含预热，以第二轮为准
+        PrintRow("pool, 4KB state", RunPool(keys, rounds, 4, 0), RunPool(keys, rounds, 4, depth));
+        PrintRow("pool, 64KB state", RunPool(keys, rounds, 64, 0), RunPool(keys, rounds, 64, depth));
+        PrintRow("http, index.html", RunHttp(keys, rounds, "/index.html", 0),
+                 RunHttp(keys, rounds, "/index.html", depth));
+        std::string big = "big.bin, " + std::to_string(bigMB) + "MB";
+        PrintRow(big.c_str(), RunHttp(keys, rounds / 10 + 1, "/big.bin", 0),
+                 RunHttp(keys, rounds / 10 + 1, "/big.bin", depth));
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+头文件介绍：
+- 基准测试共用的计时与统计工具，不依赖测试框架；
+- 每个基准测试是一个独立的可执行程序，直接打印结果，不做判定；数字只在同一台机器上前后对比才有意义；
+*/
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+/**
+ * @brief 单调时钟的纳秒数；
+ */
+inline int64_t BenchNowNS() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 一组延迟样本(纳秒)的分位数；
+ */
+struct Percentiles {
+    double mean = 0;
+    int64_t p50 = 0, p99 = 0, p999 = 0, max = 0;
+};
+
+/**
+ * @brief 计算分位数，会打乱样本的顺序；
+ */
+inline Percentiles ComputePercentiles(std::vector<int64_t>& samples) {
+    Percentiles res;
+    if(samples.empty()) { return res; }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for(int64_t s : samples) { sum += s; }
+    size_t n = samples.size();
+    res.mean = sum / n;
+    res.p50 = samples[n / 2];
+    res.p99 = samples[std::min(n - 1, n * 99 / 100)];
+    res.p999 = samples[std::min(n - 1, n * 999 / 1000)];
+    res.max = samples[n - 1];
+    return res;
+}
+
+/**
+ * @brief 以微秒为单位打印一行分位数；
+ */
+inline void PrintPercentiles(const char* name, const Percentiles& p) {
+    printf("%-28s mean %8.2f  p50 %8.2f  p99 %8.2f  p99.9 %8.2f  max %9.2f us\n", name,
+        p.mean / 1000, p.p50 / 1000.0, p.p99 / 1000.0, p.p999 / 1000.0, p.max / 1000.0);
+}
+
+#endif //BENCH_H
@@ -0,0 +1,101 @@
+/*
+忙轮询模式的延迟基准测试：
+- 事件循环线程用Epoller等待一条回环TCP连接，收到一个字节就回写一个字节；
+- 客户端线程每隔gap微秒发送一个字节并阻塞等待回复，记录往返时间；间隔让事件循环在两次请求之间进入等待，
+  阻塞模式下每次都要从epoll_wait(-1)中被唤醒，忙轮询模式下自旋预算大于间隔时请求到达时循环还在自旋；
+- 依次测阻塞模式与几种自旋预算，打印往返时间的p50/p99/p99.9；
+- 忙轮询需要事件循环独占一个CPU核心，核心数不够时自旋会与客户端争抢CPU，结果反而变差；
+用法：./busypollbench [请求数] [间隔微秒]
+*/
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <thread>
+#include <atomic>
+#include "../src/server/epoller.h"
+#include "bench.h"
+
+/**
+ * @brief 建立一条回环TCP连接；
+ * @param client 写入客户端一侧的描述符；
+ * @param server 写入服务端一侧的描述符(非阻塞)；
+ */
+static void Connect(int* client, int* server) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if(listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 1) < 0
+        || getsockname(listenFd, (sockaddr*)&addr, &len) < 0) { perror("listen"); exit(1); }
+    *client = socket(AF_INET, SOCK_STREAM, 0);
+    if(connect(*client, (sockaddr*)&addr, sizeof(addr)) < 0) { perror("connect"); exit(1); }
+    *server = accept(listenFd, nullptr, nullptr);
+    if(*server < 0) { perror("accept"); exit(1); }
+    close(listenFd);
+    int one = 1;
+    setsockopt(*client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(*server, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(*server, F_SETFL, fcntl(*server, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * @brief 运行一轮往返测试；
+ * @param budgetUS 事件循环的自旋预算，0表示阻塞模式；
+ * @param n 请求数；
+ * @param gapUS 两次请求之间的间隔；
+ * @return 每次往返的耗时；
+ */
+static std::vector<int64_t> Run(int budgetUS, int n, int gapUS) {
+    int client, server;
+    Connect(&client, &server);
+    std::atomic<bool> stop{false};
+    std::thread loop([&]() {
+        Epoller epoller;
+        epoller.SetBusyPoll(budgetUS);
+        if(budgetUS > 0) { Epoller::SetSockBusyPoll(server, budgetUS); }   // 没有权限时只有用户态自旋
+        epoller.AddFd(server, EPOLLIN, nullptr);
+        char c;
+        while(!stop.load(std::memory_order_relaxed)) {
+            if(epoller.Wait(100) <= 0) { continue; }
+            while(read(server, &c, 1) == 1) {
+                if(write(server, &c, 1) != 1) { perror("echo"); exit(1); }
+            }
+        }
+    });
+    std::vector<int64_t> samples;
+    samples.reserve(n);
+    char c = 'x';
+    for(int i = 0; i < n + n / 10; i++) {   // 前面十分之一用来预热，不计入结果
+        if(gapUS > 0) { usleep(gapUS); }
+        int64_t start = BenchNowNS();
+        if(write(client, &c, 1) != 1 || read(client, &c, 1) != 1) { perror("ping"); exit(1); }
+        if(i >= n / 10) { samples.push_back(BenchNowNS() - start); }
+    }
+    stop = true;
+    loop.join();
+    close(client);
+    close(server);
+    return samples;
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 20000;
+    int gapUS = argc > 2 ? atoi(argv[2]) : 50;
+    printf("%d round trips, %d us apart, %u CPUs\n", n, gapUS, std::thread::hardware_concurrency());
+    const int budgets[] = { 0, 20, 200, 1000 };
+    for(int budget : budgets) {
+        std::vector<int64_t> s = Run(budget, n, gapUS);
+        char name[64];
+        if(budget == 0) {
+            snprintf(name, sizeof(name), "blocking epoll_wait");
+        } else {
+            snprintf(name, sizeof(name), "busy poll %d us", budget);
+        }
+        PrintPercentiles(name, ComputePercentiles(s));
+    }
+    return 0;
+}
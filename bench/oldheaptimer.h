@@ -0,0 +1,172 @@
+/*
+头文件介绍：
+- 时间轮替换之前的小根堆定时器(原src/timer/heaptimer.*)，只作为基准测试的对照，逻辑保持原样；
+  唯一的改动是siftup_的循环条件改为i > 0，原来上浮到根结点后会用越界的下标再比较一次；
+- 放在命名空间oldtimer中，避免与时间轮的TimerNode、Clock重名；
+- 每个结点带一个std::function回调，以连接的描述符为id，通过哈希表找到结点在堆中的位置；每次操作都读取时钟；
+*/
+#ifndef OLD_HEAP_TIMER_H
+#define OLD_HEAP_TIMER_H
+
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <assert.h>
+
+namespace oldtimer {
+
+typedef std::function<void()> TimeoutCallBack;
+typedef std::chrono::high_resolution_clock Clock;
+typedef std::chrono::milliseconds MS;
+typedef Clock::time_point TimeStamp;
+
+struct TimerNode {
+    int id;
+    TimeStamp expires;
+    TimeoutCallBack cb;
+    bool operator<(const TimerNode& t) {
+        return expires < t.expires;
+    }
+};
+
+class HeapTimer {
+public:
+    HeapTimer() { heap_.reserve(64); }
+
+    ~HeapTimer() { clear(); }
+
+    /**
+     * @brief 调整已有结点的超时时间；
+     */
+    void adjust(int id, int timeout) {
+        assert(!heap_.empty() && ref_.count(id) > 0);
+        heap_[ref_[id]].expires = Clock::now() + MS(timeout);
+        if(!siftdown_(ref_[id], heap_.size())) {
+            siftup_(ref_[id]);
+        }
+    }
+
+    /**
+     * @brief 添加结点，已有时更新超时时间与回调；
+     */
+    void add(int id, int timeout, const TimeoutCallBack& cb) {
+        assert(id >= 0);
+        size_t i;
+        if(ref_.count(id) == 0) {
+            i = heap_.size();
+            ref_[id] = i;
+            heap_.push_back({id, Clock::now() + MS(timeout), cb});
+            siftup_(i);
+        } else {
+            i = ref_[id];
+            heap_[i].expires = Clock::now() + MS(timeout);
+            heap_[i].cb = cb;
+            if(!siftdown_(i, heap_.size())) {
+                siftup_(i);
+            }
+        }
+    }
+
+    /**
+     * @brief 触发指定结点的回调并删除它(连接主动关闭时使用)；
+     */
+    void doWork(int id) {
+        if(heap_.empty() || ref_.count(id) == 0) {
+            return;
+        }
+        size_t i = ref_[id];
+        TimerNode node = heap_[i];
+        node.cb();
+        del_(i);
+    }
+
+    void clear() {
+        ref_.clear();
+        heap_.clear();
+    }
+
+    /**
+     * @brief 清除超时结点；
+     */
+    void tick() {
+        while(!heap_.empty()) {
+            TimerNode node = heap_.front();
+            if(std::chrono::duration_cast<MS>(node.expires - Clock::now()).count() > 0) {
+                break;
+            }
+            node.cb();
+            pop();
+        }
+    }
+
+    void pop() {
+        assert(!heap_.empty());
+        del_(0);
+    }
+
+    int GetNextTick() {
+        tick();
+        int64_t res = -1;
+        if(!heap_.empty()) {
+            res = std::chrono::duration_cast<MS>(heap_.front().expires - Clock::now()).count();
+            if(res < 0) { res = 0; }
+        }
+        return res;
+    }
+
+    size_t size() const { return heap_.size(); }
+
+private:
+    void del_(size_t index) {
+        assert(!heap_.empty() && index < heap_.size());
+        size_t i = index;
+        size_t n = heap_.size() - 1;
+        if(i < n) {
+            SwapNode_(i, n);
+            if(!siftdown_(i, n)) {
+                siftup_(i);
+            }
+        }
+        ref_.erase(heap_.back().id);
+        heap_.pop_back();
+    }
+
+    void siftup_(size_t i) {
+        assert(i < heap_.size());
+        while(i > 0) {
+            size_t j = (i - 1) / 2;
+            if(heap_[j] < heap_[i]) { break; }
+            SwapNode_(i, j);
+            i = j;
+        }
+    }
+
+    bool siftdown_(size_t index, size_t n) {
+        assert(index < heap_.size() && n <= heap_.size());
+        size_t i = index;
+        size_t j = i * 2 + 1;
+        while(j < n) {
+            if(j + 1 < n && heap_[j + 1] < heap_[j]) j++;
+            if(heap_[i] < heap_[j]) break;
+            SwapNode_(i, j);
+            i = j;
+            j = i * 2 + 1;
+        }
+        return i > index;
+    }
+
+    void SwapNode_(size_t i, size_t j) {
+        std::swap(heap_[i], heap_[j]);
+        ref_[heap_[i].id] = i;
+        ref_[heap_[j].id] = j;
+    }
+
+    std::vector<TimerNode> heap_;
+    std::unordered_map<int, size_t> ref_;
+};
+
+}   // namespace oldtimer
+
+#endif //OLD_HEAP_TIMER_H
@@ -0,0 +1,124 @@
+/*
+线程池的基准测试，工作窃取线程池与原来的单队列线程池对比：
+- external：1个或3个外部线程(相当于Reactor)提交空任务，计到全部执行完为止，得到每个任务的平均耗时；
+- nested：外部提交的任务在工作线程里再提交15个任务(相当于任务派生子任务)；
+- batch：事件循环式的提交，每轮32个任务，新线程池用Batch一次放入，原来的线程池逐个submit；
+- wake latency：每隔200微秒提交一个任务，测从提交到开始执行的时间，线程池大部分时间在休眠，测的是唤醒的延迟；
+用法：./poolbench [任务数] [工作线程数]
+*/
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/threadpool/threadpool.h"
+#include "oldthreadpool.h"
+#include "bench.h"
+
+/**
+ * @brief 原来的线程池没有Batch，逐个提交；
+ */
+template<typename Pool>
+struct BatchOf {
+    explicit BatchOf(Pool*) {}
+};
+
+template<>
+struct BatchOf<ThreadPool> {
+    explicit BatchOf(ThreadPool* pool): batch(pool) {}
+    ThreadPool::Batch batch;
+};
+
+template<typename Pool>
+static double External(int workers, int producers, int n) {
+    std::atomic<int> done{0};
+    int64_t start = BenchNowNS();
+    {
+        Pool pool(workers);
+        std::vector<std::thread> threads;
+        for(int p = 0; p < producers; p++) {
+            threads.emplace_back([&pool, &done, n, producers]() {
+                for(int i = 0; i < n / producers; i++) {
+                    pool.submit([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+                }
+            });
+        }
+        for(auto& th : threads) { th.join(); }
+    }   // 析构时等全部任务执行完
+    return static_cast<double>(BenchNowNS() - start) / n;
+}
+
+template<typename Pool>
+static double Nested(int workers, int n) {
+    std::atomic<int> done{0};
+    int64_t start = BenchNowNS();
+    {
+        Pool pool(workers);
+        for(int i = 0; i < n / 16; i++) {
+            pool.submit([&pool, &done]() {
+                for(int k = 0; k < 15; k++) {
+                    pool.submit([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+                }
+                done.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        while(done.load() < n / 16 * 16) { std::this_thread::yield(); }
+    }
+    return static_cast<double>(BenchNowNS() - start) / n;
+}
+
+template<typename Pool>
+static double Batched(int workers, int n) {
+    const int ROUND = 32;
+    std::atomic<int> done{0};
+    int64_t start = BenchNowNS();
+    {
+        Pool pool(workers);
+        for(int i = 0; i < n / ROUND; i++) {
+            BatchOf<Pool> batch(&pool);
+            for(int k = 0; k < ROUND; k++) {
+                pool.submit([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+        }
+    }
+    return static_cast<double>(BenchNowNS() - start) / n;
+}
+
+template<typename Pool>
+static Percentiles WakeLatency(int workers, int n) {
+    std::vector<int64_t> samples(n);
+    std::atomic<int> done{0};
+    {
+        Pool pool(workers);
+        for(int i = 0; i < n; i++) {
+            usleep(200);
+            int64_t submitted = BenchNowNS();
+            pool.submit([&samples, &done, i, submitted]() {
+                samples[i] = BenchNowNS() - submitted;
+                done.fetch_add(1, std::memory_order_release);
+            });
+        }
+        while(done.load(std::memory_order_acquire) < n) { std::this_thread::yield(); }
+    }
+    return ComputePercentiles(samples);
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    int workers = argc > 2 ? atoi(argv[2]) : 6;
+    printf("%d tasks, %d workers, %u CPUs\n", n, workers, std::thread::hardware_concurrency());
+    printf("%-24s %14s %14s\n", "ns/task", "old pool", "work stealing");
+    for(int round = 0; round < 2; round++) {    // 第一轮包含预热，以第二轮为准
+        printf("%-24s %14.0f %14.0f\n", "external, 1 producer",
+               External<OldThreadPool>(workers, 1, n), External<ThreadPool>(workers, 1, n));
+        printf("%-24s %14.0f %14.0f\n", "external, 3 producers",
+               External<OldThreadPool>(workers, 3, n), External<ThreadPool>(workers, 3, n));
+        printf("%-24s %14.0f %14.0f\n", "nested 1+15",
+               Nested<OldThreadPool>(workers, n), Nested<ThreadPool>(workers, n));
+        printf("%-24s %14.0f %14.0f\n", "batch of 32",
+               Batched<OldThreadPool>(workers, n), Batched<ThreadPool>(workers, n));
+    }
+    PrintPercentiles("wake latency, old pool", WakeLatency<OldThreadPool>(workers, n / 100));
+    PrintPercentiles("wake latency, stealing", WakeLatency<ThreadPool>(workers, n / 100));
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+定时器的基准测试，时间轮与原来的小根堆对比：
+- 先给N个连接各添加一个定时器，然后模拟事件循环：每轮处理64个事件，每个事件延长一个随机连接的超时(adjust)，
+  其中1/16是连接关闭后新连接到来(删除再添加)；每轮结束调用一次GetNextTick；
+- 时间轮按服务器的用法每轮调用一次TimeService::Update，堆每次操作都读取时钟；
+- 超时时间远大于测试时长，测的是维护定时器本身的开销，不包括到期处理；
+用法：./timerbench [每种规模的事件数]
+*/
+#include <stdlib.h>
+#include <random>
+#include <vector>
+#include "../src/timer/timingwheel.h"
+#include "oldheaptimer.h"
+#include "bench.h"
+
+static const int BATCH = 64;            // 每轮事件循环处理的事件数
+static const int TIMEOUT_MS = 60000;
+
+/**
+ * @brief 预先生成的事件序列，两种定时器使用同一个序列；
+ */
+struct Event {
+    int conn;
+    bool reconnect;     // 连接关闭后新连接复用这个槽位
+};
+
+static std::vector<Event> MakeEvents(int conns, int n) {
+    std::mt19937 rng(42);
+    std::vector<Event> events(n);
+    for(auto& e : events) {
+        e.conn = rng() % conns;
+        e.reconnect = rng() % 16 == 0;
+    }
+    return events;
+}
+
+/**
+ * @brief 时间轮，返回每个事件的平均耗时(纳秒)；
+ */
+static double RunWheel(int conns, const std::vector<Event>& events) {
+    TimeService::Update();
+    std::vector<TimerNode> nodes(conns);
+    size_t expired = 0;
+    TimingWheel wheel(1, [&expired](TimerNode*) { expired++; });
+    for(int i = 0; i < conns; i++) {
+        nodes[i].data = &nodes[i];
+        wheel.add(&nodes[i], TIMEOUT_MS);
+    }
+    int64_t start = BenchNowNS();
+    for(size_t i = 0; i < events.size(); i++) {
+        const Event& e = events[i];
+        if(e.reconnect) {
+            wheel.cancel(&nodes[e.conn]);
+            wheel.add(&nodes[e.conn], TIMEOUT_MS);
+        } else {
+            wheel.adjust(&nodes[e.conn], TIMEOUT_MS);
+        }
+        if(i % BATCH == BATCH - 1) {
+            wheel.GetNextTick();
+            TimeService::Update();
+        }
+    }
+    double ns = static_cast<double>(BenchNowNS() - start) / events.size();
+    if(expired != 0 || wheel.size() != static_cast<size_t>(conns)) { printf("unexpected expiry\n"); }
+    return ns;
+}
+
+/**
+ * @brief 原来的小根堆，回调与原来的服务器一样为每个连接绑定一次；
+ */
+static double RunHeap(int conns, const std::vector<Event>& events) {
+    oldtimer::HeapTimer heap;
+    size_t closed = 0;  // 对应原来绑定的CloseConn_
+    for(int i = 0; i < conns; i++) {
+        heap.add(i, TIMEOUT_MS, [&closed]() { closed++; });
+    }
+    int64_t start = BenchNowNS();
+    for(size_t i = 0; i < events.size(); i++) {
+        const Event& e = events[i];
+        if(e.reconnect) {
+            heap.doWork(e.conn);    // 原来关闭连接时触发回调并删除结点
+            heap.add(e.conn, TIMEOUT_MS, [&closed]() { closed++; });
+        } else {
+            heap.adjust(e.conn, TIMEOUT_MS);
+        }
+        if(i % BATCH == BATCH - 1) {
+            heap.GetNextTick();
+        }
+    }
+    double ns = static_cast<double>(BenchNowNS() - start) / events.size();
+    if(heap.size() != static_cast<size_t>(conns)) { printf("unexpected expiry\n"); }
+    return ns;
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 2000000;
+    const int sizes[] = { 1000, 10000, 100000, 500000 };
+    printf("%d events per size, %d events per loop iteration\n", n, BATCH);
+    printf("%10s %14s %14s\n", "conns", "heap ns/op", "wheel ns/op");
+    for(int conns : sizes) {
+        std::vector<Event> events = MakeEvents(conns, n);
+        RunWheel(conns, events);    // 预热
+        double heap = RunHeap(conns, events);
+        double wheel = RunWheel(conns, events);
+        printf("%10d %14.1f %14.1f\n", conns, heap, wheel);
+    }
+    return 0;
+}
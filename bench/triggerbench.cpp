@@ -0,0 +1,128 @@
+/*
+触发模式的微基准测试：
+- 单个请求的完整路径：对端写入请求，连接通过Reader/Writer选出的实例读取、process、写出响应，对端读完响应；
+  分别测边缘触发与条件触发的实例，得到每个请求的耗时；
+- 单独比较读循环本身：模板化之前的循环每轮都要重新读取全局的isET标志，模板化之后循环条件是编译期常量；
+用法：./triggerbench [请求数]
+*/
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/http/httpconn.h"
+#include "bench.h"
+
+static bool runtimeET = true;   // 模板化之前HttpConn::isET的等价物
+
+/**
+ * @brief 模板化之前的读循环，循环条件是运行时的全局标志；
+ */
+__attribute__((noinline)) static ssize_t ReadRuntime(Buffer& buff, int fd, int* saveErrno) {
+    ssize_t len = -1;
+    do {
+        len = buff.ReadFd(fd, saveErrno);
+        if(len <= 0) { break; }
+    } while(runtimeET);
+    return len;
+}
+
+/**
+ * @brief 模板化之后的读循环；
+ */
+template<typename Trigger>
+__attribute__((noinline)) static ssize_t ReadStatic(Buffer& buff, int fd, int* saveErrno) {
+    ssize_t len = -1;
+    do {
+        len = buff.ReadFd(fd, saveErrno);
+        if(len <= 0) { break; }
+    } while(Trigger::isET);
+    return len;
+}
+
+/**
+ * @brief 对端发送一个请求，连接读取、处理并写出响应，对端读完响应，返回每个请求的耗时；
+ * @param et 使用哪种触发模式的实例；
+ * @param n 请求数；
+ */
+static std::vector<int64_t> RunRequests(bool et, int n) {
+    int fds[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) { perror("socketpair"); exit(1); }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    HttpConn conn;
+    sockaddr_in addr = {};
+    conn.init(fds[0], addr);
+    HttpConn::IoFunc reader = HttpConn::Reader(et);
+    HttpConn::IoFunc writer = HttpConn::Writer(et);
+    const char req[] = "GET /index.html HTTP/1.1\r\nHost: bench\r\nConnection: keep-alive\r\n\r\n";
+    std::vector<char> resp(1 << 20);
+    std::vector<int64_t> samples;
+    samples.reserve(n);
+    size_t respLen = 0;     // 第一次请求时确定响应的长度
+    for(int i = 0; i < n; i++) {
+        int64_t start = BenchNowNS();
+        if(::write(fds[1], req, sizeof(req) - 1) != static_cast<ssize_t>(sizeof(req) - 1)) { perror("write"); exit(1); }
+        int err = 0;
+        (conn.*reader)(&err);
+        if(!conn.process()) { fprintf(stderr, "process failed\n"); exit(1); }
+        size_t want = respLen ? respLen : conn.ToWriteBytes();
+        while(conn.ToWriteBytes() > 0) { (conn.*writer)(&err); }
+        size_t got = 0;
+        while(got < want) {
+            ssize_t len = ::read(fds[1], resp.data() + got, resp.size() - got);
+            if(len <= 0) { perror("read"); exit(1); }
+            got += len;
+        }
+        respLen = want;
+        samples.push_back(BenchNowNS() - start);
+    }
+    conn.Close();
+    close(fds[1]);
+    return samples;
+}
+
+/**
+ * @brief 对端先写入4段数据，再用读循环读到EAGAIN，返回每次的耗时；
+ */
+template<typename F>
+static std::vector<int64_t> RunDrain(F read, int n) {
+    int fds[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) { perror("socketpair"); exit(1); }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    Buffer buff;
+    char chunk[1024];
+    memset(chunk, 'x', sizeof(chunk));
+    std::vector<int64_t> samples;
+    samples.reserve(n);
+    for(int i = 0; i < n; i++) {
+        for(int k = 0; k < 4; k++) {
+            if(::write(fds[1], chunk, sizeof(chunk)) != sizeof(chunk)) { perror("write"); exit(1); }
+        }
+        int err = 0;
+        int64_t start = BenchNowNS();
+        read(buff, fds[0], &err);
+        samples.push_back(BenchNowNS() - start);
+        buff.RetrieveAll();
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return samples;
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    HttpConn::srcDir = RESOURCES_DIR;
+    HttpConn::SetPhaseTimeouts(60000, 60000, 60000, 60000);
+    for(int round = 0; round < 2; round++) {    // 第一轮包含预热，以第二轮为准
+        printf("round %d, %d requests\n", round + 1, n);
+        std::vector<int64_t> s = RunRequests(true, n);
+        PrintPercentiles("request ET", ComputePercentiles(s));
+        s = RunRequests(false, n);
+        PrintPercentiles("request LT", ComputePercentiles(s));
+        s = RunDrain(ReadRuntime, n);
+        PrintPercentiles("ET drain, runtime flag", ComputePercentiles(s));
+        s = RunDrain(ReadStatic<EdgeTrigger>, n);
+        PrintPercentiles("ET drain, template", ComputePercentiles(s));
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+/*
+头文件介绍：
+- C++20协程的返回类型，只在开启ENABLE_COROUTINE(定义WEBSERVER_COROUTINE宏)时使用；
+- 连接处理协程由子Reactor启动，在等待套接字就绪、定时器或数据库结果时挂起，由事件循环恢复；
+- 协程是分离式的：创建后立即运行到第一次挂起，结束时自行销毁协程帧，调用者不持有句柄；
+*/
+#ifndef CO_TASK_H
+#define CO_TASK_H
+
+#include <coroutine>
+#include <exception>
+
+struct Task {
+    struct promise_type {
+        Task get_return_object() noexcept { return {}; }
+
+        std::suspend_never initial_suspend() noexcept { return {}; }   // 创建后立即执行
+
+        std::suspend_never final_suspend() noexcept { return {}; }     // 执行完自行销毁
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() { std::terminate(); }    // 连接处理中不使用异常
+    };
+};
+
+#endif //CO_TASK_H
@@ -70,6 +70,16 @@ void Buffer::RetrieveAll() {
     writePos_ = 0;
 }
 
+/**
+ * @brief 由调用线程重新分配一块同样大小的存储并清零，丢弃原有内容；
+ * 按first touch策略新的页面落在调用线程所在的NUMA节点上；
+ */
+void Buffer::Rehome() {
+    std::vector<char>(buffer_.size()).swap(buffer_);
+    readPos_ = 0;
+    writePos_ = 0;
+}
+
 /**
  * @brief 先将缓冲区内还未读取的数据交给一个字符串，然后清空缓冲区；
  * @return 先前的字符串信息；
@@ -47,6 +47,8 @@ public:
     ssize_t ReadFd(int fd, int* Errno);
     ssize_t WriteFd(int fd, int* Errno);
 
+    void Rehome();
+
 private:
     char* BeginPtr_();
     const char* BeginPtr_() const;
@@ -9,7 +9,10 @@ using namespace std;
  */
 const char* HttpConn::srcDir;   // 资源路径，默认初始化为nullptr
 std::atomic<int> HttpConn::userCount;   // 用户数量，原子变量，操作它的时候不能干扰，默认初始化为0
-bool HttpConn::isET;    // 边缘触发还是条件触发，默认初始化为false
+size_t HttpConn::readBudget;    // 读预算，默认初始化为0(不限制)
+size_t HttpConn::writeBudget;   // 写预算，默认初始化为0(不限制)
+int HttpConn::phaseTimeoutMS_[PHASE_NUM];   // 各阶段的超时时间，由服务器启动时设置
+int HttpConn::minPhaseTimeoutMS_;
 
 /**
  * @brief 构造函数初始化套接字描述符，地址信息，连接状态；
@@ -17,7 +20,15 @@ bool HttpConn::isET;    // 边缘触发还是条件触发，默认初始化为fa
 HttpConn::HttpConn() {
     fd_ = -1;
     addr_ = { 0 };
-    isClose_ = true;
+    isClose_.store(true, std::memory_order_relaxed);
+    yield_ = false;
+    parseOk_ = false;
+    errCode_ = 400;
+    timer_.data = this;     // 定时器到期时据此找回连接
+    gen_ = 0;
+    state_ = 0;
+    phase_ = PHASE_IDLE;
+    node_ = CpuTopology::CurrentNode();
 };
 
 /**
@@ -37,9 +48,20 @@ void HttpConn::init(int fd, const sockaddr_in& addr) {
     ++userCount;    // 更新用户数量
     addr_ = addr;
     fd_ = fd;
-    writeBuff_.RetrieveAll();   // 清空读缓冲区所有字符
-    readBuff_.RetrieveAll();    // 清空写缓冲区所有字符
-    isClose_ = false;           // 更改连接状态
+    int node = CpuTopology::CurrentNode();
+    if(node >= 0 && node != node_) {    // 槽位上次由其他节点的线程使用，在本线程重新分配缓冲区，使之落在本地节点
+        writeBuff_.Rehome();
+        readBuff_.Rehome();
+        node_ = node;
+    } else {
+        writeBuff_.RetrieveAll();   // 清空读缓冲区所有字符
+        readBuff_.RetrieveAll();    // 清空写缓冲区所有字符
+    }
+    iov_[0].iov_len = iov_[1].iov_len = 0;  // 槽位是复用的，清掉上一个连接残留的待发送长度
+    iovCnt_ = 0;
+    request_.ResetScan();   // 上一个连接可能留下了没收全的请求
+    isClose_.store(false, std::memory_order_release);   // 更改连接状态
+    SetPhase_(PHASE_HEADER, true);  // 请求行与头部的期限从accept开始计算
 
     // 打印日志信息
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
@@ -47,18 +69,87 @@ void HttpConn::init(int fd, const sockaddr_in& addr) {
 
 /**
  * @brief 关闭HTTP连接；
+ * @param keepFd 为true时暂不关闭描述符，由调用者稍后关闭，在此之前描述符不会被新连接复用；
  */
-void HttpConn::Close() {
+void HttpConn::Close(bool keepFd) {
     response_.UnmapFile();  // 首先解除响应报文中文件内容的映射
-    if(isClose_ == false){  // 如果是连接着的状态
-        isClose_ = true;    // 更新状态为关闭状态
+    if(!isClose_.load(std::memory_order_relaxed)) {  // 如果是连接着的状态，只有占用者会改写它
+        isClose_.store(true, std::memory_order_release);    // 更新状态为关闭状态
         --userCount;        // 用户数量减1
-        close(fd_);         // 关闭套接字
+        // 描述符一旦关闭就可能被新连接复用，因此代数和占用状态要在close之前更新
+        gen_.fetch_add(1, std::memory_order_release);
+        state_.store(0, std::memory_order_release);
+        if(!keepFd) { close(fd_); }     // 关闭套接字
         // 打印日志
         LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
     }
 }
 
+/**
+ * @brief 尝试占用连接；已被占用时把flag留给占用者，由它在释放前处理；
+ * @param flag 占用失败时留下的标志(CLOSE_REQ、PEND_IN或PEND_OUT)；
+ * @return 占用成功返回true；
+ */
+bool HttpConn::TryOwn(uint32_t flag) {
+    uint32_t s = state_.load(std::memory_order_relaxed);
+    while(true) {
+        uint32_t next = (s & OWNED) ? (s | flag) : static_cast<uint32_t>(OWNED);
+        if(state_.compare_exchange_weak(s, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            return !(s & OWNED);
+        }
+    }
+}
+
+/**
+ * @brief 占用者处理完后调用：没有留下的标志则释放占用，否则取走标志并继续占用；
+ * @return 取走的标志，返回0表示已经释放；
+ */
+uint32_t HttpConn::Release() {
+    uint32_t s = state_.load(std::memory_order_relaxed);
+    while(true) {
+        uint32_t next = (s & ~OWNED) ? OWNED : 0;
+        if(state_.compare_exchange_weak(s, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            return s & ~OWNED;
+        }
+    }
+}
+
+/**
+ * @brief 设置各阶段的超时时间，服务器启动时调用一次；
+ * @param headerMS 请求行与头部；
+ * @param bodyMS 请求体；
+ * @param writeMS 处理与发送响应；
+ * @param idleMS 长连接空闲；
+ */
+void HttpConn::SetPhaseTimeouts(int headerMS, int bodyMS, int writeMS, int idleMS) {
+    phaseTimeoutMS_[PHASE_HEADER] = headerMS;
+    phaseTimeoutMS_[PHASE_BODY] = bodyMS;
+    phaseTimeoutMS_[PHASE_WRITE] = writeMS;
+    phaseTimeoutMS_[PHASE_IDLE] = idleMS;
+    minPhaseTimeoutMS_ = min(min(headerMS, bodyMS), min(writeMS, idleMS));
+}
+
+/**
+ * @brief 距离当前阶段的截止时间还有多少毫秒；
+ * @return 已经超时返回0；
+ */
+int HttpConn::PhaseRemainMS() const {
+    uint64_t phase = phase_.load(std::memory_order_acquire);
+    uint64_t deadline = (phase >> 2) + phaseTimeoutMS_[phase & PHASE_MASK];
+    uint64_t now = TimeService::NowMS();
+    return deadline > now ? static_cast<int>(deadline - now) : 0;
+}
+
+/**
+ * @brief 切换阶段，阶段不变时保留原来的开始时间；
+ * @param phase 新的阶段；
+ * @param restart 为true时即使阶段不变也重新计时(有了进展)；
+ */
+void HttpConn::SetPhase_(CONN_PHASE phase, bool restart) {
+    if(!restart && Phase() == phase) { return; }
+    phase_.store(static_cast<uint64_t>(TimeService::NowMS()) << 2 | phase, std::memory_order_release);
+}
+
 /**
  * @brief 返回套接字描述符；
  * @return 套接字描述符；
@@ -92,26 +183,41 @@ int HttpConn::GetPort() const { // 改成unsigned int应该会更好
 }
 
 /**
- * @brief 从套接字描述符中读取数据；
+ * @brief 从套接字描述符中读取数据，Trigger为触发模式策略，条件触发的实例只读一次，没有循环；
  * @return 成功读取的长度；
  */
+template<typename Trigger>
 ssize_t HttpConn::read(int* saveErrno) {
     ssize_t len = -1;
+    size_t total = 0;
+    yield_ = false;
     do {
         len = readBuff_.ReadFd(fd_, saveErrno); // 读取缓冲区中接收到的请求报文；
         if (len <= 0) { // 读取失败
             break;
         }
-    } while (isET); // 边缘触发就是一直读，因为边缘触发仅在被监视的文件描述符发生变化时才会触发事件通知；
+        total += len;
+        if(readBudget && total >= readBudget) { // 读够了预算就让出，剩下的数据由调用者重新排队后再读
+            yield_ = Trigger::isET;  // 条件触发下epoll会继续通知，不需要调用者额外处理
+            break;
+        }
+    } while (Trigger::isET); // 边缘触发就是一直读，因为边缘触发仅在被监视的文件描述符发生变化时才会触发事件通知；
+    if(total > 0) {
+        CONN_PHASE phase = Phase();
+        if(phase == PHASE_IDLE) { SetPhase_(PHASE_HEADER, true); }     // 下一个请求开始了
+    }
     return len;
 }
 
 /**
- * @brief 向套接字描述符中写入数据；
+ * @brief 向套接字描述符中写入数据，Trigger为触发模式策略；
  * @return 返回成功写入的字节数；
  */
+template<typename Trigger>
 ssize_t HttpConn::write(int* saveErrno) {
     ssize_t len = -1;
+    size_t total = 0;
+    yield_ = false;
 
     // 下面这个循环保证了在每一轮的读取中，会不断更新iov_数组中两个缓冲区的地址与长度信息；
     // 读完之后两个缓冲区应该都空了；
@@ -138,24 +244,87 @@ ssize_t HttpConn::write(int* saveErrno) {
             iov_[0].iov_len -= len;     // 更新长度
             writeBuff_.Retrieve(len);   // 清空这部分内容，这部分数据已经写入了描述符，写入的这些数据准备---->客户端；
         }
-    } while(isET || ToWriteBytes() > 10240);    // 如果是边缘触发，同样不断读取，10240的字节大小是根据网络负载设定的(每一轮都会更新结构体缓冲大小)
+        total += len;
+        if(writeBudget && total >= writeBudget && ToWriteBytes() > 0) { // 大文件发够了预算就让出，避免饿死其他连接
+            yield_ = true;
+            break;
+        }
+    } while(Trigger::isET || ToWriteBytes() > 10240);    // 如果是边缘触发，同样不断读取，10240的字节大小是根据网络负载设定的(每一轮都会更新结构体缓冲大小)
+    if(ToWriteBytes() == 0) {   // 响应发完，缓冲区里还有数据说明下一个请求已经开始
+        SetPhase_(readBuff_.ReadableBytes() > 0 ? PHASE_HEADER : PHASE_IDLE, true);
+    } else if(total > 0) {
+        SetPhase_(PHASE_WRITE, true);
+    }
     return len;     // 返回最后一次循环中len的值有什么意义
 }
 
+// 两种触发模式的实例都在这里生成，服务器通过Reader/Writer选择
+template ssize_t HttpConn::read<EdgeTrigger>(int* saveErrno);
+template ssize_t HttpConn::read<LevelTrigger>(int* saveErrno);
+template ssize_t HttpConn::write<EdgeTrigger>(int* saveErrno);
+template ssize_t HttpConn::write<LevelTrigger>(int* saveErrno);
+
+/**
+ * @brief 在解析之前粗略判断这个请求的处理是否可能阻塞，目前只有GET是确定不会访问数据库的；
+ * @return 不是GET请求(比如登录注册的POST会查询MySQL)时返回true，缓冲区为空时返回false；
+ */
+bool HttpConn::MayBlock() const {
+    size_t len = readBuff_.ReadableBytes();
+    return len > 0 && (len < 4 || memcmp(readBuff_.Peek(), "GET ", 4) != 0);
+}
+
 /**
  * @brief 这是连接最核心的处理流程，接收客户端的请求报文，然后设置好缓冲区；
+ * 依次调用Parse、Verify(需要的话)、Respond，全部在调用线程内完成；
  */
 bool HttpConn::process() {  // 该函数还没将缓冲区信息写入到套接字描述符，可以预见的是，必然是要先process，再write；
+    if(!Parse()) { return false; }
+    if(NeedVerify()) { Verify(); }
+    Respond();
+    return true;
+}
+
+/**
+ * @brief 解析读缓冲区中的一个请求，不访问数据库；
+ * @return 缓冲区中没有数据或请求还不完整时返回false；
+ */
+bool HttpConn::Parse() {
     request_.Init();    // 初始化http请求报文类
     if(readBuff_.ReadableBytes() <= 0) {    // 缓冲区中没有可读的数
         return false;
     }
-    else if(request_.parse(readBuff_)) {    // 服务器会将请求报文读入到缓冲区并解析；
+    size_t len = 0;
+    int errCode = 0;
+    HttpRequest::PARSE_STATE scan = request_.Scan(readBuff_, &len, &errCode);
+    if(scan != HttpRequest::FINISH) {   // 请求还没收全，继续等待读
+        SetPhase_(scan == HttpRequest::BODY ? PHASE_BODY : PHASE_HEADER, false);
+        return false;
+    }
+    Metrics::Instance()->Add(Metrics::REQUESTS);
+    if(errCode != 0) {  // 超过长度限制或Content-Length无效，回复错误后关闭连接，缓冲区中的数据不再处理
+        LOG_WARN("Client[%d] request rejected: %d", fd_, errCode);
+        readBuff_.RetrieveAll();
+        request_.ResetScan();
+        parseOk_ = false;
+        errCode_ = errCode;
+    } else {
+        parseOk_ = request_.parse(readBuff_, len);  // 只解析第一个请求，长连接上之后的请求留在缓冲区中；
+        errCode_ = 400;
+    }
+    SetPhase_(PHASE_WRITE, true);   // 查询数据库也算在这个阶段
+    return true;
+}
+
+/**
+ * @brief 根据解析(以及核验)的结果生成响应，设置好待发送的缓冲区；
+ */
+void HttpConn::Respond() {
+    if(parseOk_) {
         LOG_DEBUG("%s", request_.path().c_str());   // 路径信息打印；
         // 下面这行代码，http回应http请求，持久连接与否同request保持一致，200表示成功
         response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);   // 解析成功则返回响应
     } else {
-        response_.Init(srcDir, request_.path(), false, 400);    // 解析失败则返回错误信息，错误码设置为400
+        response_.Init(srcDir, request_.path(), false, errCode_);   // 解析失败则返回错误信息并关闭连接
     }
 
     // 解析完http的请求消息之后，服务器返回请求报文；
@@ -172,5 +341,20 @@ bool HttpConn::process() {  // 该函数还没将缓冲区信息写入到套接
         iovCnt_ = 2;
     }
     LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , iovCnt_, ToWriteBytes());
-    return true;
+}
+
+/**
+ * @brief 不处理请求，直接回复503，让客户端稍后重试；用于过载时只拒绝这一个请求，连接保持不变；
+ */
+void HttpConn::RespondBusy() {
+    static const char head[] = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\nContent-Length: 0\r\n";
+    static const char keepAlive[] = "Connection: keep-alive\r\n\r\n";
+    static const char close[] = "Connection: close\r\n\r\n";
+    response_.UnmapFile();  // 不带文件内容
+    writeBuff_.Append(head, sizeof(head) - 1);
+    if(IsKeepAlive()) { writeBuff_.Append(keepAlive, sizeof(keepAlive) - 1); }
+    else { writeBuff_.Append(close, sizeof(close) - 1); }
+    iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek());
+    iov_[0].iov_len = writeBuff_.ReadableBytes();
+    iovCnt_ = 1;
 }
@@ -13,25 +13,101 @@
 #include <arpa/inet.h>   // sockaddr_in结构体包含了地址族、端口号、IP地址等信息
 #include <stdlib.h>      // atoi()函数将字符串转为整数类型
 #include <errno.h>      
+#include <algorithm>     // min
 
 // #include "../log_system/log.h"
 #include "../sql_connection_pool/sqlconnRAII.h"
 #include "../data_buffer/buffer.h"
+#include "../metrics/metrics.h"
+#include "../timer/timingwheel.h"
+#include "../topology/cputopology.h"
 #include "httprequest.h"    // 请求报文的解析
 #include "httpresponse.h"   // 响应报文的处理
 
+/**
+ * @brief 触发模式策略，作为HttpConn::read/write的模板参数，读写循环的条件在编译期确定；
+ */
+struct EdgeTrigger {
+    static constexpr bool isET = true;      // 边缘触发：一直读(写)到EAGAIN为止
+};
+
+struct LevelTrigger {
+    static constexpr bool isET = false;     // 条件触发：读一次，剩下的交给epoll继续通知
+};
+
 class HttpConn {
 public:
+    typedef ssize_t (HttpConn::*IoFunc)(int*);  // 读写函数的类型，服务器启动时选定具体的实例
+
+    /**
+     * @brief 线程池模式下连接的占用状态，各位可以同时存在；
+     * 同一时刻只有占用者(OWNED)可以读写、关闭连接，其他线程只能留下标志，由占用者释放前处理；
+     */
+    enum OWN_STATE {
+        OWNED = 1,      // 已被某个线程占用
+        CLOSE_REQ = 2,  // 占用期间有人要求关闭(超时、对端挂断)
+        PEND_IN = 4,    // 占用期间到达了读事件
+        PEND_OUT = 8,   // 占用期间到达了写事件
+    };
+
+    /**
+     * @brief 连接所处的阶段，每个阶段有各自的超时时间，顺序与Metrics中的TIMEOUT_*计数器一致；
+     */
+    enum CONN_PHASE {
+        PHASE_HEADER = 0,   // 等待请求行与头部，从请求的第一个字节(新连接从accept)起计时，中途收到数据不延长
+        PHASE_BODY,         // 等待请求体，从头部收全起计时，中途收到数据不延长
+        PHASE_WRITE,        // 处理请求与发送响应，每发出一段数据重新计时
+        PHASE_IDLE,         // 长连接上一个响应已发完，等待下一个请求
+        PHASE_NUM,
+    };
+
     HttpConn();
     ~HttpConn();
 
     void init(int sockFd, const sockaddr_in& addr);
 
-    ssize_t read(int* saveErrno);   
+    template<typename Trigger>
+    ssize_t read(int* saveErrno);
 
+    template<typename Trigger>
     ssize_t write(int* saveErrno);
 
-    void Close();
+    /**
+     * @brief 按触发模式选择read的实例；
+     * @param et 连接事件是否带EPOLLET；
+     */
+    static IoFunc Reader(bool et) {
+        return et ? &HttpConn::read<EdgeTrigger> : &HttpConn::read<LevelTrigger>;
+    }
+
+    /**
+     * @brief 按触发模式选择write的实例；
+     * @param et 连接事件是否带EPOLLET；
+     */
+    static IoFunc Writer(bool et) {
+        return et ? &HttpConn::write<EdgeTrigger> : &HttpConn::write<LevelTrigger>;
+    }
+
+    void Close(bool keepFd = false);
+
+    bool TryOwn(uint32_t flag);
+
+    uint32_t Release();
+
+    /**
+     * @brief 直接放弃占用，仅用于主线程临时占用的场合(此时没有其他线程会留下标志)；
+     */
+    void Disown() {
+        state_.store(0, std::memory_order_release);
+    }
+
+    /**
+     * @brief 连接的代数，槽位上的连接每关闭一次加1；
+     * 定时器、投递的任务记下创建时的代数，执行时代数不同说明原来的连接已关闭，槽位可能已属于新连接；
+     */
+    uint32_t Gen() const {
+        return gen_.load(std::memory_order_acquire);
+    }
 
     int GetFd() const;
 
@@ -43,6 +119,35 @@ public:
     
     bool process();
 
+    bool Parse();
+
+    /**
+     * @brief Parse之后调用，请求是否需要查询数据库；
+     */
+    bool NeedVerify() const {
+        return parseOk_ && request_.NeedVerify();
+    }
+
+    /**
+     * @brief 查询数据库核验用户，可能阻塞，可以放到其他线程执行；
+     */
+    void Verify() {
+        request_.Verify();
+    }
+
+    void Respond();
+
+    void RespondBusy();
+
+    bool MayBlock() const;
+
+    /**
+     * @brief 响应引用的文件是否都在页缓存中，是的话发送时不会阻塞；
+     */
+    bool IsFileResident() const {
+        return response_.IsFileResident();
+    }
+
     /**
      * @brief 返回要写入(套接字)的字节数，即便是条件触发，只要需要写入的字节数较多，就得重复处理，这是write函数的机制；
      * @return 待写入套接字描述符的数据长度；
@@ -58,17 +163,73 @@ public:
         return request_.IsKeepAlive();
     }
 
-    static bool isET;   // epoll模式是边缘触发还是条件触发
+    /**
+     * @brief 上一次read/write是否因为用完预算而提前返回，此时套接字上可能还有数据可读(可写)；
+     */
+    bool IsYield() const {
+        return yield_;
+    }
+
+    /**
+     * @brief 连接的超时定时器结点，嵌在连接中，由连接所在事件循环的时间轮管理；
+     */
+    TimerNode* Timer() {
+        return &timer_;
+    }
+
+    /**
+     * @brief 连接当前所处的阶段，其他线程也可以调用；
+     */
+    CONN_PHASE Phase() const {
+        return static_cast<CONN_PHASE>(phase_.load(std::memory_order_acquire) & PHASE_MASK);
+    }
+
+    int PhaseRemainMS() const;
+
+    /**
+     * @brief 定时器下一次检查这个连接的延时：当前阶段的剩余时间，但不超过最短的阶段超时；
+     * 阶段可能在占用者处理时切换(定时器由别的线程管理时不会得到通知)，切换后的截止时间不会早于这个检查时间，
+     * 检查时截止时间未到则按新的阶段重新设定；
+     */
+    int CheckDelayMS() const {
+        return std::min(PhaseRemainMS(), minPhaseTimeoutMS_);
+    }
+
+    static void SetPhaseTimeouts(int headerMS, int bodyMS, int writeMS, int idleMS);
+
+    /**
+     * @brief 返回连接是否已经关闭；
+     */
+    bool IsClose() const {
+        return isClose_.load(std::memory_order_acquire);
+    }
+
     static const char* srcDir;  // 资源目录地址
     static std::atomic<int> userCount;  // 用户数量
+    static size_t readBudget;   // 单次read最多读取的字节数，0表示不限制
+    static size_t writeBudget;  // 单次write最多发送的字节数，0表示不限制
     
 private:
+    void SetPhase_(CONN_PHASE phase, bool restart);
+
+    static const uint64_t PHASE_MASK = 3;   // phase_的低2位是阶段，其余位是阶段开始的时间(毫秒)
+    static int phaseTimeoutMS_[PHASE_NUM];  // 各阶段的超时时间
+    static int minPhaseTimeoutMS_;          // 其中最短的一个
    
     int fd_;        // 服务端用于与客户端连接通信的文件描述符
     struct  sockaddr_in addr_;  // 地址信息
 
-    bool isClose_;  // 连接状态
+    std::atomic<bool> isClose_;     // 连接状态，占用者在工作线程中关闭，主线程不占用也会读取
+    bool yield_;    // 上一次读写因预算用完而提前返回
+    bool parseOk_;  // 当前请求是否解析成功
+    int errCode_;   // 解析失败时回复的状态码(400、413、431)
+    std::atomic<uint32_t> gen_;     // 代数，在关闭时(释放描述符之前)递增
+    std::atomic<uint32_t> state_;   // 占用状态，见OWN_STATE
+    std::atomic<uint64_t> phase_;   // 所处阶段与阶段开始的时间，由占用者更新，定时器线程读取
+    int node_;      // 缓冲区所在的NUMA节点，-1表示由未绑核的线程分配
     
+    TimerNode timer_;   // 超时定时器结点
+
     int iovCnt_;    // iov_结构体数组的长
     struct iovec iov_[2];   // 两个缓冲区，配合readv/writev使用
     
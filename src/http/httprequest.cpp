@@ -17,12 +17,16 @@ const unordered_set<string> HttpRequest::DEFAULT_HTML{
 const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
             {"/register.html", 0}, {"/login.html", 1},  };
 
+size_t HttpRequest::maxHeaderBytes;   // 头部长度上限，默认初始化为0(不限制)，由服务器启动时设置
+size_t HttpRequest::maxBodyBytes;     // 请求体长度上限，同上
+
 /**
  * @brief 初始化一个http连接请求；
  */
 void HttpRequest::Init() {
     method_ = path_ = version_ = body_ = "";    // 方法为空，路径(URL)为空，HTTP版本为空，请求体默认也为空(不选)；
     state_ = REQUEST_LINE;  // 请求行(第一行)状态，这是连接刚开始的状态
+    verifyTag_ = -1;
     header_.clear();        // header是请求报文中的请求头部
     post_.clear();          // post应该是请求报文使用POST方法时附带的请求体
 }
@@ -39,46 +43,113 @@ bool HttpRequest::IsKeepAlive() const {
 
 /**
  * @brief 针对传入缓冲区的请求报文字段做解析，也就是解析请求报文；
- * @param buff 缓冲区对象，引用类型，可修改；
+ * 只解析缓冲区开头的len个字节(由Scan得出的第一个请求的长度)，长连接上紧跟着的下一个请求留在缓冲区中；
+ * @param buff 缓冲区对象，引用类型，可修改；解析完(无论成败)取走这len个字节；
+ * @param len 第一个请求的长度；
  * @return 解析结果；
  */
-bool HttpRequest::parse(Buffer& buff) {
+bool HttpRequest::parse(Buffer& buff, size_t len) {
     const char CRLF[] = "\r\n";     // 表示回车或者换行的字符串(为了统一，选择用这个字符做换行)
-    if(buff.ReadableBytes() <= 0) { // 缓冲区可读数据必须要存在
+    if(len == 0 || buff.ReadableBytes() < len) { // 缓冲区中必须有一个完整的请求
         return false;
     }
-    while(buff.ReadableBytes() && state_ != FINISH) {   // 只要有字符可读，且解析状态没有完整，则持续循环
-        // 查找给定范围内范围内第一个CRLF子序列，HTTP的请求实质信息就是一串又一串字符串
-        // 每部分内容通过CRLF字符做区分
-        // 在可读取的地址范围中，寻找CRLF字符串信息，返回第一个匹配的位置(内存地址)
-        const char* begin_read = buff.Peek();   // 起始读位置
-        const char* end_read = buff.BeginWriteConst();  // 读位置的结束地址 
-        const char* lineEnd = search(begin_read, end_read, CRLF, CRLF + 2);
-        std::string line(begin_read, lineEnd); // 获取每一行的实质内容，首地址
+    const char* begin = buff.Peek();
+    const char* end = begin + len;  // 本请求的结束位置，不能越过它，否则会把下一个请求当作本请求的一部分
+    bool ok = true;
+    while(begin < end && state_ != FINISH) {   // 只要有字符可读，且解析状态没有完整，则持续循环
+        if(state_ == BODY) {    // 空行之后到请求结束都是请求体，可以包含CRLF
+            ParseBody_(std::string(begin, end));
+            break;
+        }
+        // 查找给定范围内第一个CRLF子序列，请求行和头部的每一行通过CRLF字符做区分
+        const char* lineEnd = search(begin, end, CRLF, CRLF + 2);
+        std::string line(begin, lineEnd); // 获取每一行的实质内容，首地址
         switch(state_)  // 根据state_的状态做处理
         {
         case REQUEST_LINE:  // 如果是解析请求行(第一行)
-            if(!ParseRequestLine_(line)) {  // 如果请求行解析失败，则返回错误
-                return false;
-            }
-            ParsePath_();   // 解析成功则开始解析路径
+            ok = ParseRequestLine_(line);
+            if(ok) { ParsePath_(); }    // 解析成功则开始解析路径
             break;    
         case HEADERS:       // 如果是解析头部
-            ParseHeader_(line); // 对头部解析，注意这边只有在到了最后的部分才会更改状态state
-            if(buff.ReadableBytes() <= 2) { // 如果可读字节数<=2，表明到此已解析完成(最后两个字节只能是CRLF)，说明不附带请求体
+            ParseHeader_(line); // 对头部解析，解析到空行时状态变为BODY
+            if(state_ == BODY && lineEnd + 2 >= end) {  // 空行就是本请求的结尾，说明不附带请求体
                 state_ = FINISH;
             }
             break;
-        case BODY:  // 如果是解析请求体
-            ParseBody_(line);
-            break;
         default:
             break;
         }
-        if(lineEnd == buff.BeginWrite()) break; // 到了尾部，直接返回
-        buff.RetrieveUntil(lineEnd + 2);    // 加上CRLF字符的两个字节
+        if(!ok || lineEnd == end) { break; }    // 出错或到了尾部
+        begin = lineEnd + 2;    // 加上CRLF字符的两个字节
     }
+    buff.Retrieve(len);     // 本请求整个取走，解析失败也不留下残余，以免被当作下一个请求
+    ResetScan();            // 缓冲区开头换成了下一个请求
     LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    return ok;
+}
+
+/**
+ * @brief 不做解析，只检查缓冲区中的第一个请求是否已经完整：头部以空行结束，请求体达到Content-Length；
+ * 进度保存在成员中，下次调用只查找新读入的数据，头部收全后只比较长度；
+ * @param buff 读缓冲区，两次调用之间只能在尾部追加数据；
+ * @param requestLen 返回FINISH且没有错误时写入第一个请求的长度(头部、空行与请求体)，之后的数据属于下一个请求；
+ * @param errCode 请求不合法时写入应回复的状态码：头部过长431，请求体过长413，Content-Length无效400；否则写入0；
+ * @return 头部不完整返回HEADERS，请求体不完整返回BODY，完整或出错返回FINISH；
+ */
+HttpRequest::PARSE_STATE HttpRequest::Scan(const Buffer& buff, size_t* requestLen, int* errCode) {
+    const char BLANK[] = "\r\n\r\n";
+    const char* begin = buff.Peek();
+    size_t readable = buff.ReadableBytes();
+    *errCode = 0;
+    if(headerLen_ == 0) {
+        const char* end = begin + readable;
+        const char* from = begin + (scanned_ > 3 ? scanned_ - 3 : 0);   // 空行可能被两次读取分开
+        const char* headerEnd = search(from, end, BLANK, BLANK + 4);
+        if(headerEnd == end) {
+            scanned_ = readable;
+            if(maxHeaderBytes && readable > maxHeaderBytes) { *errCode = 431; return FINISH; }
+            return HEADERS;
+        }
+        headerLen_ = headerEnd + 4 - begin;
+        if(maxHeaderBytes && headerLen_ > maxHeaderBytes) { *errCode = 431; return FINISH; }
+        if(!ParseContentLength_(begin, headerEnd, &bodyLen_)) { *errCode = 400; return FINISH; }
+        if(maxBodyBytes && bodyLen_ > maxBodyBytes) { *errCode = 413; return FINISH; }
+    }
+    if(readable - headerLen_ < bodyLen_) { return BODY; }
+    *requestLen = headerLen_ + bodyLen_;
+    return FINISH;
+}
+
+/**
+ * @brief 从头部中找出Content-Length，值只能是十进制数字(前后可以有空白)，出现多次时必须相同；
+ * @param begin 头部的起始位置；
+ * @param end 头部的结束位置(空行的CRLF处)；
+ * @param bodyLen 写入请求体长度，没有这个字段时为0；
+ * @return 值无法解析、溢出或多次出现且不同时返回false；
+ */
+bool HttpRequest::ParseContentLength_(const char* begin, const char* end, size_t* bodyLen) {
+    const char CRLF[] = "\r\n";
+    bool found = false;
+    *bodyLen = 0;
+    for(const char* line = begin; line < end; ) {
+        const char* lineEnd = search(line, end, CRLF, CRLF + 2);
+        if(lineEnd - line >= 15 && strncasecmp(line, "Content-Length:", 15) == 0) {
+            const char* p = line + 15;
+            while(p < lineEnd && (*p == ' ' || *p == '\t')) { ++p; }
+            if(p == lineEnd) { return false; }
+            size_t value = 0;
+            for(; p < lineEnd && *p >= '0' && *p <= '9'; ++p) {
+                size_t digit = *p - '0';
+                if(value > (SIZE_MAX - digit) / 10) { return false; }  // 溢出
+                value = value * 10 + digit;
+            }
+            while(p < lineEnd && (*p == ' ' || *p == '\t')) { ++p; }
+            if(p != lineEnd || (found && value != *bodyLen)) { return false; }
+            *bodyLen = value;
+            found = true;
+        }
+        line = lineEnd + 2;
+    }
     return true;
 }
 
@@ -179,18 +250,27 @@ void HttpRequest::ParsePost_() {
             int tag = DEFAULT_HTML_TAG.find(path_)->second; // 获取标签
             LOG_DEBUG("Tag:%d", tag);
             if(tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);
-                if(UserVerify(post_["username"], post_["password"], isLogin)) {
-                    path_ = "/welcome.html";    // 展示欢迎页
-                } 
-                else {
-                    path_ = "/error.html";      // 展示错误页
-                }
+                verifyTag_ = tag;   // 查询数据库可能阻塞，解析阶段只做记录，由调用者决定在哪个线程里调用Verify
             }
         }
     }   
 }
 
+/**
+ * @brief 查询数据库核验用户，根据结果把路径换成欢迎页或错误页；
+ */
+void HttpRequest::Verify() {
+    if(verifyTag_ < 0) { return; }
+    bool isLogin = (verifyTag_ == 1);
+    verifyTag_ = -1;
+    if(UserVerify(post_["username"], post_["password"], isLogin)) {
+        path_ = "/welcome.html";    // 展示欢迎页
+    } 
+    else {
+        path_ = "/error.html";      // 展示错误页
+    }
+}
+
 /**
  * @brief 解析从url中编码而来的数据；
  */
@@ -249,6 +329,7 @@ void HttpRequest::ParseFromUrlencoded_() {
 bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin) {
     if(name == "" || pwd == "") { return false; }   // 如果用户名为空或者密码为空，则直接返回错误的结果
     LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());   // 打印登录信息
+    ThreadPool::BlockingScope blocking;     // 等待连接和查询都会阻塞，线程池据此补充线程
     MYSQL* sql; // 定义一个指向sql连接的指针，该sql可以获取到数据库连接池中的数据库连接，因此在定义数据库连接池的时候需要传指针的指针(引用也可)
     SqlConnRAII(&sql,  SqlConnPool::Instance());    // 通过RAII机制建立连接，同时确保顺利析构
     assert(sql);    // 确保sql存在
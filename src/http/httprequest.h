@@ -11,12 +11,15 @@
 #include <string>
 #include <regex>    // 正则功能
 #include <errno.h>     
+#include <strings.h>    // strncasecmp
+#include <stdint.h>     // SIZE_MAX
 #include <mysql/mysql.h>  // mysql连接
 
 #include "../data_buffer/buffer.h"          // 内存缓冲池
 #include "../log_system/log.h"              // 日志处理
 #include "../sql_connection_pool/sqlconnpool.h"    // 用户池
 #include "../sql_connection_pool/sqlconnRAII.h"    // 数据库连接的RAII机制
+#include "../threadpool/threadpool.h"   // 查询数据库时告知线程池
 
 class HttpRequest {
 public:
@@ -47,13 +50,22 @@ public:
     /**
      * @brief 构造函数初始化HTTP连接请求；
      */
-    HttpRequest() { Init(); }
+    HttpRequest() { Init(); ResetScan(); }
 
     ~HttpRequest() = default;
 
     void Init();
 
-    bool parse(Buffer& buff);
+    bool parse(Buffer& buff, size_t len);
+
+    PARSE_STATE Scan(const Buffer& buff, size_t* requestLen, int* errCode);
+
+    /**
+     * @brief 丢弃Scan的进度，缓冲区开头不再是原来那个请求时(取走请求、清空缓冲区、连接复用)调用；
+     */
+    void ResetScan() {
+        scanned_ = headerLen_ = bodyLen_ = 0;
+    }
 
     std::string path() const;
     std::string& path();
@@ -64,6 +76,16 @@ public:
 
     bool IsKeepAlive() const;
 
+    /**
+     * @brief 解析出的请求是否还需要查询数据库核验用户(登录、注册)；
+     */
+    bool NeedVerify() const { return verifyTag_ >= 0; }
+
+    void Verify();
+
+    static size_t maxHeaderBytes;   // 请求行与头部(含空行)的长度上限，超过回复431，0表示不限制
+    static size_t maxBodyBytes;     // 请求体(Content-Length)的长度上限，超过回复413，0表示不限制
+
     /* 
     计算实现对FormData以及Json的解析
     void HttpConn::ParseFormData() {}
@@ -81,7 +103,14 @@ private:
 
     static bool UserVerify(const std::string& name, const std::string& pwd, bool isLogin);
 
+    static bool ParseContentLength_(const char* begin, const char* end, size_t* bodyLen);
+
     PARSE_STATE state_; // 定义一个枚举变量表示解析状态
+    // Scan的进度，跨多次读取保留(Init不清除)，避免每次从头查找空行
+    size_t scanned_;    // 缓冲区开头已经查找过、不含空行的字节数
+    size_t headerLen_;  // 第一个请求头部(含空行)的长度，0表示头部还没收全
+    size_t bodyLen_;    // 第一个请求的Content-Length
+    int verifyTag_;     // 待核验的页面标签(0注册，1登录)，-1表示不需要核验
     std::string method_, path_, version_, body_;    // 方法、(网页)路径、版本、请求体
     std::unordered_map<std::string, std::string> header_;   // 请求头部是键值对类型
     std::unordered_map<std::string, std::string> post_;     // POST方法中附带的请求体？
@@ -40,6 +40,8 @@ const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 413, "Payload Too Large" },
+    { 431, "Request Header Fields Too Large" },
 };
 
 /**
@@ -49,6 +51,8 @@ const unordered_map<int, string> HttpResponse::CODE_PATH = {
     { 400, "/400.html" },
     { 403, "/403.html" },
     { 404, "/404.html" },
+    { 413, "/413.html" },
+    { 431, "/431.html" },
 };
 
 /**
@@ -95,7 +99,9 @@ void HttpResponse::MakeResponse(Buffer& buff) {
     /* 判断请求的资源文件 */
     // string的data函数返回一个底层字符串指针，这段字符串会传进指向mmFileStat_变量的地址
     // 如果stat的返回值小于0，那么表明获取失败，或者获取到的文件信息是一个目录，那么返回404(没找到)
-    if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
+    if(code_ >= 400) {  // 请求本身有错(解析失败、超过长度限制)，保留状态码，不检查请求的文件(空路径会被当成目录而回复404)
+    }
+    else if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
         code_ = 404;
     }
     else if(!(mmFileStat_.st_mode & S_IROTH)) { // 如果其他用户没有(读)访问权限，则错误码设定为403
@@ -165,6 +171,11 @@ void HttpResponse::AddHeader_(Buffer& buff) {
         buff.Append("close\r\n");
     }
     buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    TimeService::Text now;     // 同一秒内的响应共用格式化好的日期
+    TimeService::Format(TimeService::NowUS() / 1000000, &now);
+    buff.Append("Date: ", 6);
+    buff.Append(now.http, strlen(now.http));
+    buff.Append("\r\n", 2);
 }
 
 /**
@@ -182,7 +193,8 @@ void HttpResponse::AddContent_(Buffer& buff) {
     // 也就是对内存内容的修改不会影响文本本身的内容
     LOG_DEBUG("file path %s", (srcDir_ + path_).data());    // 在日志上打印网页文件的具体路径信息
     int* mmRet = (int*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if(*mmRet == -1) {
+    if(mmRet == MAP_FAILED) {   // 不能解引用来判断，那样会访问文件的第一页，冷文件会在这里阻塞
+        close(srcFd);
         ErrorContent(buff, "File NotFound!");   // 如果有错误信息，那么将错误信息写入到响应体，没有错误信息，响应体不写入信息；
         return; 
     }
@@ -201,6 +213,28 @@ void HttpResponse::UnmapFile() {
     }
 }
 
+/**
+ * @brief 通过mincore检查映射的文件页是否都在页缓存中；
+ * @return 没有映射文件或者全部驻留时返回true，有页面需要从磁盘读取时返回false；
+ */
+bool HttpResponse::IsFileResident() const {
+    if(!mmFile_ || mmFileStat_.st_size == 0) { return true; }
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t pages = (mmFileStat_.st_size + pageSize - 1) / pageSize;
+    unsigned char stackVec[64];     // 256KB以内的文件不需要额外分配
+    std::vector<unsigned char> heapVec;
+    unsigned char* vec = stackVec;
+    if(pages > sizeof(stackVec)) {
+        heapVec.resize(pages);
+        vec = heapVec.data();
+    }
+    if(mincore(mmFile_, mmFileStat_.st_size, vec) < 0) { return false; }
+    for(size_t i = 0; i < pages; i++) {
+        if(!(vec[i] & 1)) { return false; }
+    }
+    return true;
+}
+
 /**
  * @brief 根据后缀来判断文件类型；
  * @return 返回具体的文件类型；
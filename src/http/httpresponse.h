@@ -15,6 +15,7 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
+#include <vector>
 #include <fcntl.h>       // 主要用于文件描述符
 #include <unistd.h>      // 访问系统调用
 #include <sys/stat.h>    // 访问文件状态
@@ -22,6 +23,7 @@
 
 #include "../data_buffer/buffer.h"  // 缓冲池
 #include "../log_system/log.h"      // 日志系统
+#include "../timer/timeservice.h"   // Date头部
 
 class HttpResponse {
 public:
@@ -40,6 +42,8 @@ public:
     char* File();
     // 获取文件长度
     size_t FileLen() const;
+    // 映射的文件是否全部在页缓存中，发送时不会因缺页而阻塞
+    bool IsFileResident() const;
 
     // 将错误内容也写入缓冲区，message应该是传递更具体的内容，后续看运用
     void ErrorContent(Buffer& buff, std::string message);
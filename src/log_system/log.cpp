@@ -133,18 +133,17 @@ void Log::init(int level = 1, const char* path, const char* suffix,
  * @param format 格式化字符串，比如说printf中的("the %dth file:", n)，一种特殊的字符串形式；
  */
 void Log::write(int level, const char *format, ...) {
-    struct timeval now = {0, 0};    // 起始秒数，微秒数，每次写都会获取准确的时间信息，以决定是否要加后缀
-    gettimeofday(&now, nullptr);    // 第一个参数是now的地址，第二个参数存储时区信息，我们暂且不管时区
-    time_t tSec = now.tv_sec;       // 获取秒数
-    struct tm *sysTime = localtime(&tSec);  // 基于1900年1月1日获取具体时间
-    struct tm t = *sysTime;
+    // 时间取自时间服务：事件循环线程直接用本轮缓存的时间，日期字符串每秒只格式化一次
+    int64_t nowUS = TimeService::NowUS();
+    TimeService::Text t;
+    TimeService::Format(nowUS / 1000000, &t);
     va_list vaList;                 // va_list是一个可变参数类型
 
     // 日志日期 日志行数
     // 第一部分的条件是不同日期的情况
     // 第二部分的条件是日志已经写满的情况，两个条件只要有一个满足，说明要建立新的日志文件了
     // 所以这部分判断语句的功能是：如果日期发生变化，或者日志写满，则建立新的日志记录
-    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_  %  MAX_LINES == 0)))
+    if (toDay_ != t.mday || (lineCount_ && (lineCount_  %  MAX_LINES == 0)))
     {
         // unique_lock<mutex> locker(mtx_);
         // locker.unlock();
@@ -154,12 +153,12 @@ void Log::write(int level, const char *format, ...) {
         char tail[36] = {0};
 
         // 说明一下该函数的功能，tail是一个字符串，最长为36，
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+        snprintf(tail, 36, "%.4s_%.2s_%.2s", t.log, t.log + 5, t.log + 8);  // 从"2024-01-02 ..."中取出年月日
 
-        if (toDay_ != t.tm_mday)    // 若是新一天的日志，则起一个新的文件
+        if (toDay_ != t.mday)    // 若是新一天的日志，则起一个新的文件
         {
             snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-            toDay_ = t.tm_mday;
+            toDay_ = t.mday;
             lineCount_ = 0;
         }
         else {  // 如果是同一天，则直接在文件名后面加上序号
@@ -181,14 +180,14 @@ void Log::write(int level, const char *format, ...) {
         unique_lock<mutex> locker(mtx_);
         lineCount_++;
 
-        // n表示的是成功向缓冲区写入的字符总数
-        // 在C的struct tm结构中，月份的取值范围是0到11
-        int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                    t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                    t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-        
-        // 更新写入到的位置            
-        buff_.HasWritten(n);
+        // 前缀"2024-01-02 15:04:05.123456 "：日期部分直接复制，只需要填上微秒
+        char stamp[28];
+        memcpy(stamp, t.log, 19);
+        stamp[19] = '.';
+        int us = static_cast<int>(nowUS % 1000000);
+        for(int i = 25; i > 19; i--, us /= 10) { stamp[i] = '0' + us % 10; }
+        stamp[26] = ' ';
+        buff_.Append(stamp, 27);
         // 向缓冲区写入日志等级信息，这些全是向缓冲区写入
         AppendLogLevelTitle_(level);
 
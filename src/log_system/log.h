@@ -15,6 +15,7 @@
 #include <sys/stat.h>         // 声明了一些与文件状态和文件系统相关的函数和宏。
 #include "blockqueue.h"
 #include "../data_buffer/buffer.h"
+#include "../timer/timeservice.h"    // 缓存的时间与日期字符串
 
 class Log {
 public:
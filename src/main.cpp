@@ -3,12 +3,59 @@
 */ 
 #include <unistd.h>
 #include "server/webserver.h"
+#include "server/prefork.h"
 
 int main() {
-    WebServer server(
-        1316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
-        3306, "ping", "ping", "login_info", /* Mysql配置 */
-        12, 6, true, 1, 1024);             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
-    server.Start();
+    ServerConfig config;
+    config.reactorNum = 0;  /* 子Reactor数量，0为单Reactor+线程池模式，多核下可设为CPU核数 */
+    config.ioBackend = 0;   /* 就绪通知后端 0:epoll 1:io_uring-poll(只替代epoll_ctl/epoll_wait) */
+    config.connPrefault = false;    /* 启动时预分配全部连接对象 */
+    config.persistentET = false;    /* 多Reactor模式下连接只注册一次读写事件(边缘触发) */
+    config.timerTickMS = 10;    /* 超时定时器的精度(毫秒) */
+    config.headerTimeoutMS = 10000; /* 请求行与头部的期限，防止慢速攻击长期占用连接，0为沿用timeoutMs */
+    config.bodyTimeoutMS = 20000;   /* 请求体的期限，与maxBodyBytes一起限制慢速上传 */
+    config.writeTimeoutMS = 20000;  /* 响应两次发出数据的最长间隔 */
+    config.idleTimeoutMS = 15000;   /* 长连接空闲的最长时间 */
+    config.maxHeaderBytes = 8 * 1024;   /* 请求头部上限，超过回复431，0为不限制 */
+    config.maxBodyBytes = 1024 * 1024;  /* 请求体上限，超过回复413，0为不限制 */
+    config.metricsIntervalMS = 0;   /* 计数器写入日志的间隔，0为关闭 */
+    config.busyPollUS = 0;  /* 忙轮询预算(微秒)，用CPU换取尾延迟，0为关闭 */
+    config.busyPollMask = ~0u;  /* 开启忙轮询的Reactor，按位对应 */
+    config.coroutine = false;   /* 多Reactor模式下以协程处理连接，需以-DENABLE_COROUTINE=ON编译 */
+    config.inlineMode = false;  /* 单Reactor模式下静态请求在主线程内直接完成，只有数据库请求和冷文件交给线程池 */
+    config.listenBacklog = 1024;    /* listen积压队列长度 */
+    config.acceptBudget = 64;   /* 每次监听事件最多accept的连接数 */
+    config.deferAcceptS = 1;    /* TCP_DEFER_ACCEPT秒数，0为关闭 */
+    config.readBudget = 64 * 1024;  /* 每次读事件最多读取的字节数，0为不限制 */
+    config.writeBudget = 256 * 1024;    /* 每次写事件最多发送的字节数，0为不限制 */
+    config.workerNum = 0;   /* 工作进程数量，大于0时为多进程模式，主进程负责监督重启 */
+    config.upgradePath = nullptr;   /* 热升级路径，如"./webserver.sock"，新进程启动时会从旧进程接过监听套接字 */
+    config.drainTimeoutMS = 5000;   /* 旧进程排空连接的最长时间 */
+    config.reactorCpus = nullptr;   /* 事件循环绑核，如"0-3"，同一NUMA节点上的核放在一起；nullptr为不绑定 */
+    config.threadMin = 0;   /* 线程池空闲时收缩到的线程数(如2)，0为不收缩 */
+    config.threadMax = 0;   /* 线程池扩容上限(如32，数据库查询阻塞时补充线程)，0为不扩容 */
+    config.poolTargetWaitMS = 5;    /* 任务排队超过这么久就扩容 */
+    config.poolIdleMS = 30000;  /* 线程空闲超过这么久就退出 */
+    config.poolSpinUS = 0;      /* 线程没有任务时先自旋这么久(如50)再休眠，省去短暂空档的休眠与唤醒，0为直接休眠 */
+    config.workerCpus = nullptr;    /* 工作线程绑核，如"4-9"，一般与reactorCpus在同一节点 */
+    config.dbThreads = 0;   /* 数据库通道线程数(如12，不超过连接池数量)，数据库变慢时只影响登录注册，0为不分通道 */
+    config.dbQueueLimit = 64;   /* 数据库通道排队上限，排满回复503 */
+    config.dbNice = 0;      /* 数据库通道线程的nice增量(如5)，静态请求优先 */
+    config.codelTargetMS = 0;   /* 线程池排队时间目标(如5)，持续超过时排队过久的请求直接回复503，0为关闭 */
+    config.codelIntervalMS = 100;   /* 判断持续积压的区间 */
+    config.affinityDepth = 0;   /* 按连接分派到固定线程时所属队列的深度上限，多核且连接状态较大时打开，0为共享队列 */
+
+    auto run = [&config](int workerId) {
+        config.workerId = workerId;
+        WebServer server(
+            1316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
+            3306, "ping", "ping", "login_info", /* Mysql配置 */
+            12, 6, true, 1, 1024,              /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+            config);                           /* 扩展配置 */
+        server.Start();
+    };
+    if(config.workerNum > 0) {  // 多进程模式，WebServer在各工作进程中创建
+        return Prefork::Run(config.workerNum, run);
+    }
+    run(-1);
 } 
-  
\ No newline at end of file
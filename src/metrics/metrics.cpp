@@ -0,0 +1,140 @@
+/*
+运行时计数器的具体实现
+*/
+#include "metrics.h"
+#include <stdlib.h>     // strtoull
+
+/**
+ * @brief 计数器的名字，与COUNTER的顺序一一对应；
+ */
+const char* Metrics::NAMES_[COUNTER_NUM] = {
+    "requests", "epoll_ctl", "accepts", "rejects",
+    "timeout_header", "timeout_body", "timeout_write", "timeout_idle",
+    "pool_spawn", "pool_retire", "db_lane", "db_shed", "codel_shed",
+    "pool_spill", "pool_home_steal",
+};
+
+/**
+ * @brief 直方图的名字，与HISTOGRAM的顺序一一对应；
+ */
+const char* Metrics::HIST_NAMES_[HISTOGRAM_NUM] = {
+    "queue_delay_us",
+};
+
+/**
+ * @brief 获取唯一的实例；
+ */
+Metrics* Metrics::Instance() {
+    static Metrics metrics;
+    return &metrics;
+}
+
+/**
+ * @brief 构造函数，所有计数器清零；
+ */
+Metrics::Metrics() : nextShard_(0) {
+    for(Shard& shard : shards_) {
+        for(int i = 0; i < COUNTER_NUM; i++) { shard.counters[i].store(0, std::memory_order_relaxed); }
+        for(int h = 0; h < HISTOGRAM_NUM; h++) {
+            for(int i = 0; i < BUCKET_NUM; i++) { shard.buckets[h][i].store(0, std::memory_order_relaxed); }
+        }
+    }
+    for(int i = 0; i < COUNTER_NUM; i++) { last_[i] = 0; }
+    for(int h = 0; h < HISTOGRAM_NUM; h++) {
+        for(int i = 0; i < BUCKET_NUM; i++) { lastBuckets_[h][i] = 0; }
+    }
+    lastOverflows_ = lastDrops_ = 0;
+    ReadListenStats_(&lastOverflows_, &lastDrops_);
+}
+
+/**
+ * @brief 读取计数器的当前值，即各分片之和；
+ */
+uint64_t Metrics::Get(COUNTER c) const {
+    uint64_t sum = 0;
+    for(const Shard& shard : shards_) { sum += shard.counters[c].load(std::memory_order_relaxed); }
+    return sum;
+}
+
+/**
+ * @brief 从/proc/net/netstat中读取监听队列的溢出与丢弃计数；
+ * TcpExt占两行，第一行是字段名，第二行是对应的值；
+ * @return 读取成功时返回true；
+ */
+bool Metrics::ReadListenStats_(uint64_t* overflows, uint64_t* drops) {
+    FILE* fp = fopen("/proc/net/netstat", "r");
+    if(!fp) { return false; }
+    char names[4096], values[4096];
+    bool found = false;
+    while(fgets(names, sizeof(names), fp) && fgets(values, sizeof(values), fp)) {
+        if(strncmp(names, "TcpExt:", 7) != 0) { continue; }
+        char* nameSave = nullptr;
+        char* valueSave = nullptr;
+        char* name = strtok_r(names, " \n", &nameSave);
+        char* value = strtok_r(values, " \n", &valueSave);
+        while(name && value) {
+            if(strcmp(name, "ListenOverflows") == 0) { *overflows = strtoull(value, nullptr, 10); found = true; }
+            else if(strcmp(name, "ListenDrops") == 0) { *drops = strtoull(value, nullptr, 10); }
+            name = strtok_r(nullptr, " \n", &nameSave);
+            value = strtok_r(nullptr, " \n", &valueSave);
+        }
+        break;
+    }
+    fclose(fp);
+    return found;
+}
+
+/**
+ * @brief 把各计数器的总量和距上次报告的增量写入日志，只应由一个线程调用；
+ */
+void Metrics::Report() {
+    uint64_t cur[COUNTER_NUM];
+    for(int i = 0; i < COUNTER_NUM; i++) {
+        cur[i] = Get(static_cast<COUNTER>(i));
+        LOG_INFO("[metrics] %s: %llu (+%llu)", NAMES_[i],
+                 (unsigned long long)cur[i], (unsigned long long)(cur[i] - last_[i]));
+    }
+    uint64_t reqs = cur[REQUESTS] - last_[REQUESTS];
+    if(reqs > 0) {
+        LOG_INFO("[metrics] epoll_ctl per request: %.2f", (double)(cur[EPOLL_CTL] - last_[EPOLL_CTL]) / reqs);
+    }
+    for(int i = 0; i < COUNTER_NUM; i++) { last_[i] = cur[i]; }
+    for(int h = 0; h < HISTOGRAM_NUM; h++) { ReportHistogram_(h); }
+
+    uint64_t overflows = 0, drops = 0;
+    if(ReadListenStats_(&overflows, &drops)) {
+        LOG_INFO("[metrics] ListenOverflows: %llu (+%llu), ListenDrops: %llu (+%llu)",
+                 (unsigned long long)overflows, (unsigned long long)(overflows - lastOverflows_),
+                 (unsigned long long)drops, (unsigned long long)(drops - lastDrops_));
+        lastOverflows_ = overflows;
+        lastDrops_ = drops;
+    }
+}
+
+/**
+ * @brief 输出直方图在本区间内的样本数与分位数，分位数取所在桶的上界，区间内没有样本时不输出；
+ * @param h 直方图编号；
+ */
+void Metrics::ReportHistogram_(int h) {
+    uint64_t delta[BUCKET_NUM];
+    uint64_t total = 0;
+    for(int i = 0; i < BUCKET_NUM; i++) {
+        uint64_t cur = 0;
+        for(const Shard& shard : shards_) { cur += shard.buckets[h][i].load(std::memory_order_relaxed); }
+        delta[i] = cur - lastBuckets_[h][i];
+        lastBuckets_[h][i] = cur;
+        total += delta[i];
+    }
+    if(total == 0) { return; }
+    static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+    unsigned long long bound[4];
+    for(int q = 0; q < 4; q++) {
+        uint64_t rank = static_cast<uint64_t>(QUANTILES[q] * total);
+        uint64_t seen = 0;
+        int i = 0;
+        while(i < BUCKET_NUM - 1 && (seen += delta[i]) <= rank) { i++; }
+        bound[q] = 1ULL << i;   // 第i个桶的上界
+    }
+    LOG_INFO("[metrics] %s: n=%llu p50<=%llu p90<=%llu p99<=%llu p999<=%llu", HIST_NAMES_[h],
+             (unsigned long long)total, bound[0], bound[1], bound[2], bound[3]);
+}
@@ -0,0 +1,115 @@
+/*
+头文件介绍：
+- 服务器运行时的计数器，用于观察各项优化的实际效果；
+- 计数器按线程分片，每个线程累加自己分片(独占缓存行)中的原子变量，各线程可以随意调用，热点计数器不会在核间来回迁移；
+- 读取时把所有分片相加；线程数超过分片数时多个线程共用一个分片，仍然正确，只是会有少量争用；
+- 由WebServer按固定间隔调用Report()写入日志；
+- 另有按2的幂分桶(微秒)的直方图，Report时输出区间内的样本数与分位数(所在桶的上界)，如任务在线程池中的排队时间；
+- 同时输出内核/proc/net/netstat中的ListenOverflows与ListenDrops(整个网络命名空间的累计值)，用来观察accept队列溢出；
+*/
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "../log_system/log.h"
+
+class Metrics {
+public:
+    /**
+     * @brief 计数器编号，新增计数器时同步补充NAMES_；
+     */
+    enum COUNTER {
+        REQUESTS = 0,   // 处理的请求数
+        EPOLL_CTL,      // 实际发出的epoll_ctl调用数
+        ACCEPTS,        // accept成功的连接数
+        REJECTS,        // 因过载(连接数超限或描述符耗尽)回复503的连接数
+        TIMEOUT_HEADER, // 请求行与头部超时关闭的连接数，以下四个与HttpConn::CONN_PHASE的顺序一致
+        TIMEOUT_BODY,   // 请求体超时
+        TIMEOUT_WRITE,  // 处理与发送响应超时
+        TIMEOUT_IDLE,   // 长连接空闲超时
+        POOL_SPAWN,     // 线程池因排队时间过长而新增的线程数
+        POOL_RETIRE,    // 线程池中空闲退出的线程数
+        DB_LANE,        // 交给数据库通道的请求数
+        DB_SHED,        // 数据库通道排满而回复503的请求数
+        CODEL_SHED,     // 线程池持续积压时排队过久、直接回复503的请求数
+        POOL_SPILL,     // 按连接分派时所属线程的队列太深、改放进注入队列的任务数
+        POOL_HOME_STEAL,    // 按连接分派的任务被其他空闲线程取走执行的次数
+        COUNTER_NUM,
+    };
+
+    /**
+     * @brief 直方图编号，新增直方图时同步补充HIST_NAMES_；
+     */
+    enum HISTOGRAM {
+        QUEUE_DELAY = 0,    // 任务在线程池中的排队时间(微秒)
+        HISTOGRAM_NUM,
+    };
+
+    static Metrics* Instance();
+
+    /**
+     * @brief 累加计数器；
+     * @param c 计数器编号；
+     * @param n 增量；
+     */
+    void Add(COUNTER c, uint64_t n = 1) {
+        Shard_().counters[c].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 记录一个样本，第i个桶存放[2^(i-1), 2^i)的值，0放在第0个桶；
+     * @param h 直方图编号；
+     * @param value 样本值，负数按0处理；
+     */
+    void Observe(HISTOGRAM h, int64_t value) {
+        int bucket = value > 0 ? 64 - __builtin_clzll(static_cast<uint64_t>(value)) : 0;
+        if(bucket >= BUCKET_NUM) { bucket = BUCKET_NUM - 1; }
+        Shard_().buckets[h][bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t Get(COUNTER c) const;
+
+    void Report();
+
+private:
+    static bool ReadListenStats_(uint64_t* overflows, uint64_t* drops);
+
+    void ReportHistogram_(int h);
+
+    static const int BUCKET_NUM = 40;   // 最后一个桶收纳所有更大的值
+    static const int SHARD_NUM = 64;    // 分片数量，一般不少于服务器的线程数
+
+    /**
+     * @brief 一个线程的计数器与直方图，独占缓存行，避免与其他线程的分片伪共享；
+     */
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counters[COUNTER_NUM];
+        std::atomic<uint64_t> buckets[HISTOGRAM_NUM][BUCKET_NUM];
+    };
+
+    /**
+     * @brief 当前线程的分片，线程第一次调用时按顺序分配；
+     */
+    Shard& Shard_() {
+        static thread_local int index = nextShard_.fetch_add(1, std::memory_order_relaxed) % SHARD_NUM;
+        return shards_[index];
+    }
+
+    Metrics();
+    ~Metrics() = default;
+
+    Shard shards_[SHARD_NUM];
+    std::atomic<int> nextShard_;    // 下一个线程使用的分片
+    uint64_t last_[COUNTER_NUM];    // 上一次Report时的值，用于计算区间增量
+    uint64_t lastOverflows_;    // 上一次Report时内核的ListenOverflows
+    uint64_t lastDrops_;        // 上一次Report时内核的ListenDrops
+    uint64_t lastBuckets_[HISTOGRAM_NUM][BUCKET_NUM];  // 上一次Report时各桶的值
+
+    static const char* NAMES_[COUNTER_NUM];
+    static const char* HIST_NAMES_[HISTOGRAM_NUM];
+};
+
+#endif //METRICS_H
@@ -0,0 +1,56 @@
+/*
+连接表的具体实现
+*/
+#include "conntable.h"
+
+/**
+ * @brief 构造函数，建立块索引，按需预分配全部连接对象；
+ * @param maxFd 最大描述符(不含)，即服务器能处理的最大连接数；
+ * @param prefault 是否在启动时一次性分配全部连接对象；
+ */
+ConnTable::ConnTable(int maxFd, bool prefault):
+            maxFd_(maxFd), chunkCnt_((maxFd + CHUNK_SIZE - 1) / CHUNK_SIZE),
+            chunks_(new std::atomic<HttpConn*>[chunkCnt_]) {
+    assert(maxFd > 0);
+    for(int i = 0; i < chunkCnt_; i++) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    if(prefault) {  // 构造HttpConn时缓冲区会被清零，相当于把页面都提前访问了一遍
+        for(int i = 0; i < chunkCnt_; i++) { AllocChunk_(i); }
+    }
+}
+
+/**
+ * @brief 析构函数，释放所有块，HttpConn的析构会关闭仍然打开的连接；
+ */
+ConnTable::~ConnTable() {
+    for(int i = 0; i < chunkCnt_; i++) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 获取描述符对应的连接槽位，所在块未分配时先分配；
+ * @param fd 文件描述符，需小于maxFd；
+ * @return 指向连接对象的指针，槽位在表的生命周期内一直有效；
+ */
+HttpConn* ConnTable::Acquire(int fd) {
+    HttpConn* conn = Get(fd);
+    if(conn) { return conn; }
+    return AllocChunk_(fd / CHUNK_SIZE) + fd % CHUNK_SIZE;
+}
+
+/**
+ * @brief 分配一个块，已经被其他线程分配过则直接返回；
+ * @param idx 块的下标；
+ * @return 块的首地址；
+ */
+HttpConn* ConnTable::AllocChunk_(int idx) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    HttpConn* chunk = chunks_[idx].load(std::memory_order_relaxed);
+    if(!chunk) {
+        chunk = new HttpConn[CHUNK_SIZE];
+        chunks_[idx].store(chunk, std::memory_order_release);
+    }
+    return chunk;
+}
@@ -0,0 +1,49 @@
+/*
+头文件介绍：
+- 以文件描述符为下标的连接表，替代原来的unordered_map<int, HttpConn>；
+- 连接对象按块(CHUNK_SIZE个一组)分配，块一旦分配就不再释放，连接关闭后槽位直接复用，避免反复构造与析构；
+- 可以在启动时一次性分配全部块(预分配)，把缺页开销挪到启动阶段；
+- 事件循环通过epoll_event.data.ptr直接拿到连接对象，热路径上没有哈希查找；
+*/
+#ifndef CONN_TABLE_H
+#define CONN_TABLE_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <assert.h>
+
+#include "../http/httpconn.h"
+
+class ConnTable {
+public:
+    explicit ConnTable(int maxFd, bool prefault = false);
+
+    ~ConnTable();
+
+    HttpConn* Acquire(int fd);
+
+    /**
+     * @brief 获取描述符对应的连接对象，槽位所在的块尚未分配时返回nullptr；
+     * @param fd 文件描述符；
+     */
+    HttpConn* Get(int fd) const {
+        assert(fd >= 0 && fd < maxFd_);
+        HttpConn* chunk = chunks_[fd / CHUNK_SIZE].load(std::memory_order_acquire);
+        return chunk ? chunk + fd % CHUNK_SIZE : nullptr;
+    }
+
+    int MaxFd() const { return maxFd_; }
+
+private:
+    HttpConn* AllocChunk_(int idx);
+
+    static const int CHUNK_SIZE = 256;  // 每块的连接数
+
+    int maxFd_;     // 最大描述符(不含)
+    int chunkCnt_;  // 块的数量
+    std::unique_ptr<std::atomic<HttpConn*>[]> chunks_;  // 每一块的首地址，多个Reactor线程可能同时读取
+    std::mutex mtx_;    // 分配新块时互斥
+};
+
+#endif //CONN_TABLE_H
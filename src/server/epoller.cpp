@@ -1,11 +1,17 @@
 #include "epoller.h"
 
+#ifndef SO_PREFER_BUSY_POLL     // 5.11之前的头文件没有这个选项
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
 /**
  * @brief 构造函数创建epoll描述符，设定监测的最大事件参数；
  * @param epollFd_ epoll文件描述符；
  * @param events 监测的最大事件数；
+ * @param maxFd 缓存注册事件的描述符上限；
  */
-Epoller::Epoller(int maxEvent):epollFd_(epoll_create(512)), events_(maxEvent){
+Epoller::Epoller(int maxEvent, int maxFd):epollFd_(epoll_create(512)), maxFd_(maxFd), busyPollUS_(0),
+            interest_(new Interest[maxFd]()), events_(maxEvent){
     assert(epollFd_ >= 0 && events_.size() > 0);    // 需要满足合理条件
 }
 
@@ -20,28 +26,28 @@ Epoller::~Epoller() {
  * @brief 添加文件描述符和感兴趣的事件类型(两者相互关联，信息糅在一个结构体当中)；
  * @param fd 要添加的文件描述符；
  * @param events 关注的事件类型；
+ * @param ptr 事件就绪时返回的指针(一般指向连接对象)；
  * @return 描述符的添加结果；
  */
-bool Epoller::AddFd(int fd, uint32_t events) {  
+bool Epoller::AddFd(int fd, uint32_t events, void* ptr) {
     if(fd < 0) return false;    // 不合理的文件描述符
-    epoll_event ev = {0};       // 初始化的epoll事件
-    ev.data.fd = fd;            // 更新描述符
-    ev.events = events;         // 更新其中的事件
-    return 0 == epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);    // epoll_ctl成功时返回0，否则返回-1
+    return Ctl_(EPOLL_CTL_ADD, fd, events, ptr);
 }
 
 /**
  * @brief 修改文件描述符和感兴趣的事件类型(两者相互关联)；
  * @param fd 要修改的文件描述符；
  * @param events 修改所关注的事件类型；
+ * @param ptr 事件就绪时返回的指针，EPOLL_CTL_MOD会覆盖原有的data，因此需要重新传入；
  * @return 描述符的添加结果；
  */
-bool Epoller::ModFd(int fd, uint32_t events) {  // 
+bool Epoller::ModFd(int fd, uint32_t events, void* ptr) {
     if(fd < 0) return false;
-    epoll_event ev = {0};
-    ev.data.fd = fd;
-    ev.events = events;
-    return 0 == epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);    // 同样通过epoll_ctl处理
+    if(fd < maxFd_ && !(events & EPOLLONESHOT)  // ONESHOT触发后已被禁用，必须重新注册
+            && interest_[fd].events == events && interest_[fd].ptr == ptr) {
+        return true;    // 与已注册的内容相同，省去一次系统调用
+    }
+    return Ctl_(EPOLL_CTL_MOD, fd, events, ptr);    // 同样通过epoll_ctl处理
 }
 
 /**
@@ -51,8 +57,24 @@ bool Epoller::ModFd(int fd, uint32_t events) {  //
  */
 bool Epoller::DelFd(int fd) {
     if(fd < 0) return false;
-    epoll_event ev = {0};
-    return 0 == epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, &ev);
+    return Ctl_(EPOLL_CTL_DEL, fd, 0, nullptr);
+}
+
+/**
+ * @brief 调用epoll_ctl，成功后更新缓存的注册内容；
+ * @param op EPOLL_CTL_ADD/MOD/DEL；
+ * @return epoll_ctl是否成功；
+ */
+bool Epoller::Ctl_(int op, int fd, uint32_t events, void* ptr) {
+    epoll_event ev = {0};       // 初始化的epoll事件
+    ev.data.ptr = ptr;          // 就绪时直接拿到指针，省去一次查找
+    ev.events = events;         // 更新其中的事件
+    Metrics::Instance()->Add(Metrics::EPOLL_CTL);
+    bool ret = (0 == epoll_ctl(epollFd_, op, fd, &ev));    // epoll_ctl成功时返回0，否则返回-1
+    if(fd < maxFd_ && (ret || op == EPOLL_CTL_DEL)) {  // 删除失败说明描述符本来就不在epoll中，同样清空
+        interest_[fd] = { events, ptr };
+    }
+    return ret;
 }
 
 /**
@@ -61,17 +83,54 @@ bool Epoller::DelFd(int fd) {
  * @return 阻塞时间到期后就绪的文件描述符数量；
  */
 int Epoller::Wait(int timeoutMs) {
+    if(busyPollUS_ > 0 && timeoutMs != 0) { // 忙轮询：先不让出CPU，预算用完还没有事件再阻塞
+        auto start = std::chrono::steady_clock::now();
+        auto budget = std::chrono::microseconds(busyPollUS_);
+        std::chrono::steady_clock::duration spent;
+        do {
+            int n = epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), 0);
+            if(n != 0) { return n; }
+            spent = std::chrono::steady_clock::now() - start;
+        } while(spent < budget);
+        if(timeoutMs > 0) {     // 自旋的时间从超时中扣除
+            timeoutMs -= static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(spent).count());
+            if(timeoutMs < 0) { timeoutMs = 0; }
+        }
+    }
     // &events_[0]传入事件数组的首地址
     return epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), timeoutMs);
 }
 
 /**
- * @brief 获取事件数组指定位置的事件的文件描述符；(理解为某事件下对应的文件描述符)
- * @return 文件描述符；
+ * @brief 设置Wait的自旋预算；
+ * @param budgetUS 自旋的微秒数，0表示关闭；
+ * @return 总是成功；
+ */
+bool Epoller::SetBusyPoll(int budgetUS) {
+    busyPollUS_ = budgetUS > 0 ? budgetUS : 0;
+    return true;
+}
+
+/**
+ * @brief 给连接套接字设置SO_BUSY_POLL与SO_PREFER_BUSY_POLL，让内核在读取时直接轮询网卡队列；
+ * 超过net.core.busy_read的取值需要CAP_NET_ADMIN，没有权限时只保留用户态自旋；
+ * @param fd 连接套接字；
+ * @param budgetUS 内核忙轮询的微秒数；
+ * @return 设置是否成功；
+ */
+bool Epoller::SetSockBusyPoll(int fd, int budgetUS) {
+    int prefer = 1;
+    if(setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &budgetUS, sizeof(budgetUS)) < 0) { return false; }
+    return setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer)) == 0;
+}
+
+/**
+ * @brief 获取事件数组指定位置的事件在注册时附带的指针；
+ * @return 注册时传入的指针；
  */
-int Epoller::GetEventFd(size_t i) const {
+void* Epoller::GetEventPtr(size_t i) const {
     assert(i < events_.size() && i >= 0);
-    return events_[i].data.fd;
+    return events_[i].data.ptr;
 }
 
 /**
@@ -1,6 +1,9 @@
 /*
 头文件介绍：
 - 通过epoll实现服务器的IO复用，提升资源使用效率；
+- 记录每个描述符当前注册的事件，ModFd与已注册的内容相同时不再调用epoll_ctl；
+- 带EPOLLONESHOT的注册在事件触发后会被内核禁用，即使事件相同也必须重新注册，因此不做省略；
+- 可选的忙轮询模式：用CPU换取尾延迟，阻塞之前先以0超时自旋一段时间；
 */ 
 #ifndef EPOLLER_H
 #define EPOLLER_H
@@ -11,27 +14,51 @@
 #include <assert.h>     // close()
 #include <vector>
 #include <errno.h>
+#include <memory>
+#include <chrono>
+#include <sys/socket.h> // SO_BUSY_POLL
+#include "poller.h"     // IO后端的抽象接口
+#include "../metrics/metrics.h" // 统计epoll_ctl的调用次数
 
-class Epoller {
+class Epoller : public Poller {
 public:
-    explicit Epoller(int maxEvent = 1024);
+    explicit Epoller(int maxEvent = 1024, int maxFd = 65536);
 
     ~Epoller();
 
-    bool AddFd(int fd, uint32_t events);    
+    bool AddFd(int fd, uint32_t events, void* ptr) override;
 
-    bool ModFd(int fd, uint32_t events);
+    bool ModFd(int fd, uint32_t events, void* ptr) override;
 
-    bool DelFd(int fd);
+    bool DelFd(int fd) override;
 
-    int Wait(int timeoutMs = -1);
+    int Wait(int timeoutMs = -1) override;
 
-    int GetEventFd(size_t i) const;
+    void* GetEventPtr(size_t i) const override;
 
-    uint32_t GetEvents(size_t i) const;
+    uint32_t GetEvents(size_t i) const override;
+
+    const char* Name() const override { return "epoll"; }
+
+    bool SetBusyPoll(int budgetUS) override;
+
+    static bool SetSockBusyPoll(int fd, int budgetUS);
         
 private:
+    /**
+     * @brief 描述符当前在epoll中注册的内容；
+     */
+    struct Interest {
+        uint32_t events;
+        void* ptr;
+    };
+
+    bool Ctl_(int op, int fd, uint32_t events, void* ptr);
+
     int epollFd_;   // epoll实例的文件描述符
+    int maxFd_;     // interest_能记录的描述符上限，超出的描述符不做缓存
+    int busyPollUS_;    // 每次Wait自旋的时间预算，0表示直接阻塞
+    std::unique_ptr<Interest[]> interest_;  // 以描述符为下标，各描述符只会被一个线程修改
 
     // epoll_event是Linux系统中用于描述事件的结构体，定义了这么一个结构体数组；
     // 该结构体包含数据与用户信息等内容；
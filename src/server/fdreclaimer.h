@@ -0,0 +1,50 @@
+/*
+头文件介绍：
+- 已关闭连接的描述符延迟释放：关闭时先shutdown(对端立即看到连接关闭)，描述符本身攒到事件循环处理完本轮事件再close；
+- 描述符没有释放之前不会被accept复用，本轮取回的事件里残留的旧事件只会落在已关闭的连接上，不会误伤复用同一槽位的新连接；
+- 单Reactor模式下工作线程也会关闭连接，因此加锁；
+*/
+#ifndef FD_RECLAIMER_H
+#define FD_RECLAIMER_H
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <mutex>
+#include <vector>
+
+class FdReclaimer {
+public:
+    /**
+     * @brief 连接已关闭(HttpConn::Close(true))并已从IO后端删除，关闭收发，描述符留到Reclaim时释放，可在任意线程调用；
+     * @param fd 连接的描述符；
+     */
+    void Retire(int fd) {
+        shutdown(fd, SHUT_RDWR);
+        std::lock_guard<std::mutex> locker(mtx_);
+        fds_.push_back(fd);
+    }
+
+    /**
+     * @brief 释放攒下的描述符，由事件循环在两轮事件之间调用；
+     */
+    void Reclaim() {
+        std::vector<int> fds;
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            if(fds_.empty()) { return; }
+            fds.swap(fds_);
+        }
+        for(int fd : fds) { close(fd); }
+    }
+
+    size_t Size() {
+        std::lock_guard<std::mutex> locker(mtx_);
+        return fds_.size();
+    }
+
+private:
+    std::mutex mtx_;
+    std::vector<int> fds_;  // 已关闭、等待释放的描述符
+};
+
+#endif //FD_RECLAIMER_H
@@ -0,0 +1,118 @@
+/*
+监听套接字交接的具体实现，交接过程中的收发都是阻塞的，但设置了超时，不会把进程卡死；
+*/
+#include "handover.h"
+
+/**
+ * @brief 填充Unix域套接字地址；
+ * @param path 套接字路径；
+ * @param addr 要填充的地址；
+ * @return 路径过长时返回false；
+ */
+bool Handover::MakeAddr_(const char* path, sockaddr_un* addr) {
+    if(!path || strlen(path) >= sizeof(addr->sun_path)) { return false; }
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strncpy(addr->sun_path, path, sizeof(addr->sun_path) - 1);
+    return true;
+}
+
+/**
+ * @brief 设置收发超时；
+ */
+void Handover::SetTimeout_(int fd, int timeoutMS) {
+    struct timeval tv = { timeoutMS / 1000, (timeoutMS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/**
+ * @brief 新进程调用：连接旧进程，取回它的监听套接字；
+ * @param path 旧进程等待交接的Unix域套接字路径；
+ * @return 取回的监听套接字，没有旧进程或交接失败时返回-1；
+ */
+int Handover::Fetch(const char* path) {
+    sockaddr_un addr;
+    if(!MakeAddr_(path, &addr)) { return -1; }
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sock < 0) { return -1; }
+    SetTimeout_(sock, TIMEOUT_MS);
+    if(connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {    // 没有旧进程在等待
+        close(sock);
+        return -1;
+    }
+
+    char byte = 0;
+    struct iovec iov = { &byte, 1 };
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int fd = -1;
+    if(recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) > 0) {
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    if(fd >= 0 && send(sock, &byte, 1, MSG_NOSIGNAL) != 1) {   // 确认失败，旧进程会继续服务，这边放弃
+        close(fd);
+        fd = -1;
+    }
+    close(sock);
+    return fd;
+}
+
+/**
+ * @brief 建立等待交接的Unix域监听套接字，已存在的同名文件(上一个进程留下的)会被替换；
+ * @param path 套接字路径；
+ * @return 监听套接字，失败返回-1；
+ */
+int Handover::Listen(const char* path) {
+    sockaddr_un addr;
+    if(!MakeAddr_(path, &addr)) { return -1; }
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(sock < 0) { return -1; }
+    unlink(path);
+    if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 1) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/**
+ * @brief 旧进程调用：通过SCM_RIGHTS把监听套接字发给新进程，并等待确认；
+ * @param connFd 与新进程之间的连接；
+ * @param fd 要交出去的监听套接字；
+ * @return 新进程确认收到时返回true；
+ */
+bool Handover::Send(int connFd, int fd) {
+    SetTimeout_(connFd, TIMEOUT_MS);
+    int flags = fcntl(connFd, F_GETFL, 0);
+    fcntl(connFd, F_SETFL, flags & ~O_NONBLOCK);    // accept出来的连接继承了非阻塞标志，这里需要阻塞收发
+
+    char byte = 'L';
+    struct iovec iov = { &byte, 1 };
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    if(sendmsg(connFd, &msg, MSG_NOSIGNAL) != 1) { return false; }
+    return recv(connFd, &byte, 1, 0) == 1;  // 等待新进程确认
+}
@@ -0,0 +1,34 @@
+/*
+头文件介绍：
+- 热升级时在新旧进程之间交接监听套接字；
+- 旧进程在一个Unix域套接字上等待，新进程启动时连接上来，旧进程通过SCM_RIGHTS把监听套接字发过去；
+- 新进程收到后回复一个字节确认，旧进程收到确认后才停止accept并开始排空连接，确认失败则继续正常服务；
+*/
+#ifndef HANDOVER_H
+#define HANDOVER_H
+
+#include <sys/socket.h>
+#include <sys/un.h>     // sockaddr_un
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+
+class Handover {
+public:
+    static int Fetch(const char* path);
+
+    static int Listen(const char* path);
+
+    static bool Send(int connFd, int fd);
+
+private:
+    static bool MakeAddr_(const char* path, sockaddr_un* addr);
+
+    static void SetTimeout_(int fd, int timeoutMS);
+
+    static const int TIMEOUT_MS = 3000; // 交接过程中单次收发的超时时间
+};
+
+#endif //HANDOVER_H
@@ -0,0 +1,22 @@
+/*
+IO后端的创建
+*/
+#include "poller.h"
+#include "epoller.h"
+#include "uringpoller.h"
+
+/**
+ * @brief 按配置创建IO后端，io_uring初始化失败(内核不支持或被禁用)时回退到epoll；
+ * @param backend 后端类型，见IO_BACKEND；
+ * @param maxEvent 单次Wait最多返回的事件数；
+ * @return 指向后端的智能指针；
+ */
+std::unique_ptr<Poller> Poller::Create(int backend, int maxEvent) {
+    if(backend == URING_POLL_BACKEND) {
+        std::unique_ptr<UringPoller> uring(new UringPoller(maxEvent));
+        if(uring->IsValid()) {
+            return uring;   // 返回时隐式转换并移动
+        }
+    }
+    return std::unique_ptr<Poller>(new Epoller(maxEvent));
+}
@@ -0,0 +1,51 @@
+/*
+头文件介绍：
+- IO多路复用后端的抽象接口，接口形式与原来的Epoller保持一致(AddFd/ModFd/DelFd/Wait)；
+- 事件的表示统一使用epoll的事件位(EPOLLIN、EPOLLOUT、EPOLLONESHOT、EPOLLET等)，上层代码无需关心具体后端；
+- 注册时附带一个指针(相当于epoll_event.data.ptr)，就绪时原样返回，上层据此直接拿到连接对象；
+- 通过Create在启动时选择后端，便于在同一台机器上对比epoll与io_uring的就绪通知；后端只负责通知，连接的读写、accept都是普通的系统调用；
+*/
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <sys/epoll.h>  // 事件位沿用epoll的定义
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+
+/**
+ * @brief 可选的IO后端；
+ */
+enum IO_BACKEND {
+    EPOLL_BACKEND = 0,  // epoll，默认
+    URING_POLL_BACKEND, // io_uring的POLL_ADD就绪通知，只替代epoll_ctl/epoll_wait，不可用时自动回退到epoll
+};
+
+class Poller {
+public:
+    virtual ~Poller() = default;
+
+    virtual bool AddFd(int fd, uint32_t events, void* ptr) = 0;
+
+    virtual bool ModFd(int fd, uint32_t events, void* ptr) = 0;
+
+    virtual bool DelFd(int fd) = 0;
+
+    virtual int Wait(int timeoutMs = -1) = 0;
+
+    virtual void* GetEventPtr(size_t i) const = 0;
+
+    virtual uint32_t GetEvents(size_t i) const = 0;
+
+    virtual const char* Name() const = 0;   // 后端名字，打印日志用
+
+    /**
+     * @brief 开启忙轮询：Wait先以0超时反复检查budgetUS微秒，仍然没有事件再阻塞；
+     * @return 后端不支持时返回false；
+     */
+    virtual bool SetBusyPoll(int budgetUS) { (void)budgetUS; return false; }
+
+    static std::unique_ptr<Poller> Create(int backend, int maxEvent = 1024);
+};
+
+#endif //POLLER_H
@@ -0,0 +1,94 @@
+/*
+多进程模式的具体实现，主进程中不创建任何线程，保证fork是安全的；
+主进程没有初始化日志系统，监督信息直接输出到标准错误；
+*/
+#include "prefork.h"
+
+volatile sig_atomic_t Prefork::stop_ = 0;
+
+/**
+ * @brief 主进程的信号处理函数，只设置标志，由waitpid被打断后处理；
+ */
+void Prefork::OnSignal_(int sig) {
+    (void)sig;
+    stop_ = 1;
+}
+
+/**
+ * @brief fork一个工作进程；
+ * @param id 工作进程编号；
+ * @param worker 工作进程的入口；
+ * @return 子进程的pid，失败返回-1；
+ */
+pid_t Prefork::Spawn_(int id, const Worker& worker) {
+    pid_t pid = fork();
+    if(pid == 0) {
+        signal(SIGTERM, SIG_DFL);   // 恢复默认的信号处理
+        signal(SIGINT, SIG_DFL);
+        prctl(PR_SET_PDEATHSIG, SIGTERM);   // 主进程意外退出时工作进程也跟着退出
+        if(getppid() == 1) { _exit(0); }    // fork之后、设置之前主进程就已经退出了
+        worker(id);
+        _exit(0);   // 不返回到main中，避免执行主进程的后续逻辑
+    }
+    if(pid < 0) {
+        perror("Prefork: fork");
+    }
+    return pid;
+}
+
+/**
+ * @brief 启动并监督工作进程，直到收到SIGTERM/SIGINT；
+ * @param workerNum 工作进程数量；
+ * @param worker 工作进程的入口，在子进程中执行；
+ * @return 主进程的退出码；
+ */
+int Prefork::Run(int workerNum, const Worker& worker) {
+    if(workerNum <= 0) { return 1; }
+    struct sigaction sa;
+    sa.sa_handler = OnSignal_;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;    // 不设置SA_RESTART，让waitpid被信号打断
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+
+    std::vector<pid_t> pids(workerNum, -1);
+    std::vector<time_t> startTime(workerNum, 0);
+    for(int i = 0; i < workerNum; i++) {
+        pids[i] = Spawn_(i, worker);
+        startTime[i] = time(nullptr);
+    }
+    fprintf(stderr, "Prefork: master %d started %d workers\n", getpid(), workerNum);
+
+    while(!stop_) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if(pid < 0) {
+            if(errno == EINTR) { continue; }    // 被信号打断，回到循环检查stop_
+            sleep(RESTART_DELAY_S);     // 没有子进程(fork全部失败)，稍后重试
+        }
+        for(int i = 0; i < workerNum && !stop_; i++) {
+            if(pid > 0 && pids[i] != pid) { continue; }
+            if(pid < 0 && pids[i] > 0) { continue; }
+            if(pid > 0) {
+                if(WIFSIGNALED(status)) {
+                    fprintf(stderr, "Prefork: worker %d(pid %d) killed by signal %d, restarting\n", i, pid, WTERMSIG(status));
+                } else {
+                    fprintf(stderr, "Prefork: worker %d(pid %d) exited with %d, restarting\n", i, pid, WEXITSTATUS(status));
+                }
+                if(time(nullptr) - startTime[i] < RESTART_DELAY_S) { sleep(RESTART_DELAY_S); }
+            }
+            pids[i] = Spawn_(i, worker);
+            startTime[i] = time(nullptr);
+        }
+    }
+
+    // 通知所有工作进程退出并回收
+    for(pid_t pid : pids) {
+        if(pid > 0) { kill(pid, SIGTERM); }
+    }
+    for(pid_t pid : pids) {
+        if(pid > 0) { waitpid(pid, nullptr, 0); }
+    }
+    fprintf(stderr, "Prefork: master %d quit\n", getpid());
+    return 0;
+}
@@ -0,0 +1,36 @@
+/*
+头文件介绍：
+- 多进程(prefork)模式：主进程fork出N个工作进程，每个工作进程是一个完整的WebServer；
+- 工作进程各自用SO_REUSEPORT绑定同一端口，由内核在它们之间分配新连接，某个进程崩溃或卡住不影响其他进程；
+- 线程、日志、数据库连接池等都在fork之后由工作进程自己创建，主进程只负责监督：工作进程退出后重新拉起，收到SIGTERM/SIGINT时通知所有工作进程退出；
+*/
+#ifndef PREFORK_H
+#define PREFORK_H
+
+#include <functional>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>  // PR_SET_PDEATHSIG
+
+class Prefork {
+public:
+    typedef std::function<void(int)> Worker;   // 工作进程的入口，参数为工作进程编号
+
+    static int Run(int workerNum, const Worker& worker);
+
+private:
+    static pid_t Spawn_(int id, const Worker& worker);
+
+    static void OnSignal_(int sig);
+
+    static volatile sig_atomic_t stop_; // 收到了退出信号
+
+    static const int RESTART_DELAY_S = 1;   // 工作进程启动后很快退出时，重启前等待的秒数，避免反复崩溃时空转
+};
+
+#endif //PREFORK_H
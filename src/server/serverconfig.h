@@ -0,0 +1,55 @@
+/*
+头文件介绍：
+- 服务器的扩展配置项；
+- 构造函数中的参数保持原样，新增的调优参数统一放到这个结构体里，main.cpp中按需修改即可；
+*/
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+/**
+ * @brief 服务器的扩展配置，所有成员都带有默认值，默认值即为原有的单Reactor行为(请求上限、读写预算、TCP_DEFER_ACCEPT都关闭，积压队列为原来的6)；
+ * timerTickMS与acceptBudget例外，它们只改变超时的精度与accept的先后，不改变对外的行为；调优后的取值见main.cpp；
+ */
+struct ServerConfig {
+    int reactorNum = 0;     // 子Reactor数量(一般取CPU核数)，0表示沿用主线程epoll+线程池的模式
+    int ioBackend = 0;      // 就绪通知后端，0为epoll，1为io_uring的POLL_ADD(只替代epoll，读写仍是普通系统调用，不可用时自动回退到epoll)，见IO_BACKEND
+    bool connPrefault = false;  // 是否在启动时预分配全部连接对象(约MAX_FD个)
+    bool persistentET = false;  // 多Reactor模式下连接只注册一次EPOLLIN|EPOLLOUT|EPOLLET，之后不再调用epoll_ctl修改
+    int timerTickMS = 10;   // 超时定时器(时间轮)的tick粒度，超时时间向上取整到它的整数倍
+    int headerTimeoutMS = 0;    // 请求行与头部的期限，从请求的第一个字节起算，中途收到数据不延长，0表示沿用timeoutMS
+    int bodyTimeoutMS = 0;  // 请求体的期限，从头部收全起算，中途收到数据不延长，0表示沿用timeoutMS
+    int writeTimeoutMS = 0; // 处理请求以及响应两次发出数据之间的最长间隔，0表示沿用timeoutMS
+    int idleTimeoutMS = 0;  // 长连接发完响应后等待下一个请求的最长时间，0表示沿用timeoutMS
+    int maxHeaderBytes = 0;     // 请求行与头部的长度上限，超过回复431并关闭连接，0表示不限制
+    int maxBodyBytes = 0;       // 请求体的长度上限，Content-Length超过它回复413并关闭连接，0表示不限制
+    int metricsIntervalMS = 0;  // 运行计数器写入日志的间隔，0表示不输出
+    int busyPollUS = 0;     // 忙轮询预算(微秒)，Wait阻塞前先自旋这么久，0表示关闭(仅epoll后端)
+    unsigned busyPollMask = ~0u;    // 哪些Reactor开启忙轮询，第i位对应第i个子Reactor，单Reactor模式下看第0位
+    bool coroutine = false;     // 多Reactor模式下用C++20协程处理连接，需要以-DENABLE_COROUTINE=ON编译
+    bool inlineMode = false;    // 单Reactor模式下，不会阻塞的静态请求直接在主线程内读、处理、发送，不经过线程池
+    int listenBacklog = 6;      // listen的积压队列长度(受net.core.somaxconn限制)，连接突增时应调大(如1024)
+    int acceptBudget = 64;  // 每次监听事件最多accept的连接数，用完后先处理其他事件再继续
+    int deferAcceptS = 0;   // TCP_DEFER_ACCEPT的秒数，客户端发来数据后才唤醒accept，0表示关闭
+    int readBudget = 0;     // 每次读事件最多读取的字节数，用完后让出并重新排队，0表示读到EAGAIN为止
+    int writeBudget = 0;    // 每次写事件最多发送的字节数，大文件分多轮发送，0表示不限制
+    int workerNum = 0;      // 工作进程数量，大于0时main.cpp以prefork模式运行，每个进程一个WebServer
+    int workerId = -1;      // 当前工作进程的编号，由Prefork设置，-1表示单进程
+    bool reusePort = false; // 监听套接字是否开启SO_REUSEPORT，多进程模式下必须开启
+    const char* upgradePath = nullptr;  // 热升级用的Unix域套接字路径，nullptr表示不开启
+    int drainTimeoutMS = 5000;  // 热升级后旧进程排空连接的最长时间
+    const char* reactorCpus = nullptr;  // 事件循环线程绑定的CPU列表(如"0-3,8")，第i个子Reactor用第i个，主循环用第reactorNum个(按长度取模)，nullptr表示不绑定
+    int threadMin = 0;      // 线程池空闲收缩后至少保留的线程数，0表示与threadNum相同(不收缩)
+    int threadMax = 0;      // 线程池扩容的上限，不大于threadNum时不扩容
+    int poolTargetWaitMS = 5;   // 任务在线程池中排队超过这么久就扩容
+    int poolIdleMS = 30000;     // 线程池的线程空闲超过这么久就退出
+    int poolSpinUS = 0;     // 线程池的线程没有任务时先自旋这么久再休眠，0表示直接休眠(单CPU时总是直接休眠)
+    const char* workerCpus = nullptr;   // 线程池工作线程绑定的CPU列表，第k个线程用第k个(按长度取模)，nullptr表示不绑定
+    int dbThreads = 0;      // 数据库通道的线程数，查询数据库的请求(登录、注册)在这里执行，0表示不单独开通道，与其他请求共用线程池
+    int dbQueueLimit = 64;  // 数据库通道最多排队的请求数(向上取整到2的幂)，排满后新的数据库请求直接回复503
+    int dbNice = 0;         // 数据库通道线程的nice值增量，大于0时CPU紧张时让给处理其他请求的线程
+    int codelTargetMS = 0;  // 线程池任务排队时间的目标，一个区间内排队时间始终高于它时，排队超过两倍的新请求直接回复503，0表示不丢弃
+    int codelIntervalMS = 100;  // 判断是否持续积压的区间长度
+    int affinityDepth = 0;  // 大于0时按连接分派：同一连接的任务交给固定的工作线程，它已排了这么多任务时改进共享队列；0表示所有任务进共享队列
+};
+
+#endif //SERVER_CONFIG_H
@@ -0,0 +1,543 @@
+/*
+子Reactor的具体实现：
+- 事件循环运行在自己的线程中，连接的读、处理、写都在本线程内完成，不再经过线程池；
+- 其他线程(主Reactor)通过QueueInLoop投递任务，并写eventfd唤醒epoll_wait；
+*/
+#include "subreactor.h"
+
+using namespace std;
+
+/**
+ * @brief 构造函数，创建本线程独占的IO后端、定时器以及用于唤醒的eventfd；
+ * @param id Reactor编号；
+ * @param timeoutMS 连接的超时时间；
+ * @param connEvent 连接事件，由主Reactor根据触发模式设定；
+ * @param ioBackend IO后端类型，见IO_BACKEND；
+ * @param users 共用的连接表；
+ * @param persistent 是否使用持久的边缘触发注册，要求connEvent带EPOLLET；
+ * @param busyPollUS 忙轮询预算(微秒)，0表示关闭；
+ * @param dbPool 查询数据库的请求交给这个线程池执行，nullptr表示在本线程查询；
+ * @param coroutine 以协程方式处理连接，要求dbPool非空(需定义WEBSERVER_COROUTINE)；
+ * @param timerTickMS 时间轮的tick粒度(毫秒)；
+ * @param cpu 事件循环线程绑定的CPU，-1表示不绑定；
+ */
+SubReactor::SubReactor(int id, int timeoutMS, uint32_t connEvent, int ioBackend, ConnTable* users,
+                       bool persistent, int busyPollUS, ThreadPool* dbPool, bool coroutine, int timerTickMS, int cpu):
+            id_(id), timeoutMS_(timeoutMS), connEvent_(connEvent), persistent_(persistent),
+            busyPollUS_(busyPollUS), cpu_(cpu), dbPool_(dbPool), coroutine_(coroutine), readFn_(HttpConn::Reader(connEvent & EPOLLET)),
+            writeFn_(HttpConn::Writer(connEvent & EPOLLET)), isClose_(false),
+            wakeupFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), connCount_(0), isDraining_(false),
+            epoller_(Poller::Create(ioBackend)), timer_(new TimingWheel(timerTickMS, [this](TimerNode* node) {
+                OnTimeout_(static_cast<HttpConn*>(node->data));
+            })), users_(users) {
+    assert(wakeupFd_ >= 0 && users_);
+    assert(!persistent_ || (connEvent_ & EPOLLET));
+    assert(!coroutine_ || dbPool_);
+    if(busyPollUS_ > 0 && !epoller_->SetBusyPoll(busyPollUS_)) { busyPollUS_ = 0; }  // 后端不支持则关闭
+    epoller_->AddFd(wakeupFd_, EPOLLIN, &wakeupFd_);    // eventfd使用条件触发即可，用&wakeupFd_标识
+}
+
+/**
+ * @brief 析构函数，停止事件循环，结束还挂起的协程，关闭eventfd；
+ */
+SubReactor::~SubReactor() {
+    Stop();
+#ifdef WEBSERVER_COROUTINE
+    if(coroutine_) { FinishCo_(); }
+#endif
+    close(wakeupFd_);
+}
+
+/**
+ * @brief 启动事件循环线程；
+ */
+void SubReactor::Start() {
+    thread_ = std::thread(&SubReactor::Loop_, this);
+}
+
+/**
+ * @brief 停止事件循环，并等待线程退出；
+ */
+void SubReactor::Stop() {
+    isClose_ = true;
+    Wakeup_();
+    if(thread_.joinable()) { thread_.join(); }
+}
+
+/**
+ * @brief 主Reactor调用，把一个新连接交给本Reactor，线程安全；
+ * @param fd 已经设置为非阻塞的连接套接字；
+ * @param addr 客户端地址；
+ */
+void SubReactor::AddConn(int fd, const sockaddr_in& addr) {
+    QueueInLoop(std::bind(&SubReactor::AddClient_, this, fd, addr));
+}
+
+/**
+ * @brief 向事件循环投递一个任务，任务会在本Reactor的线程中执行；
+ * @param cb 要执行的任务；
+ */
+void SubReactor::QueueInLoop(Functor cb) {
+    {
+        lock_guard<mutex> locker(mtx_);
+        pending_.push_back(std::move(cb));
+    }
+    Wakeup_();
+}
+
+/**
+ * @brief 进入排空状态(热升级)，长连接发完当前响应后关闭，所有连接最多再保留timeoutMS毫秒；
+ * @param timeoutMS 排空的最长时间；
+ */
+void SubReactor::Drain(int timeoutMS) {
+    QueueInLoop([this, timeoutMS] {
+        isDraining_ = true;
+        if(timeoutMS_ > 0) { timer_->shrink(timeoutMS); }
+    });
+}
+
+/**
+ * @brief 向eventfd写入数据，使阻塞在epoll_wait上的线程返回；
+ */
+void SubReactor::Wakeup_() {
+    uint64_t one = 1;
+    ssize_t n = ::write(wakeupFd_, &one, sizeof(one));
+    if(n != sizeof(one)) {
+        LOG_ERROR("Reactor[%d] wakeup error!", id_);
+    }
+}
+
+/**
+ * @brief 读空eventfd，并执行其他线程投递过来的任务；
+ */
+void SubReactor::HandleWakeup_() {
+    uint64_t cnt = 0;
+    ssize_t n = ::read(wakeupFd_, &cnt, sizeof(cnt));
+    (void)n;
+    vector<Functor> functors;
+    {   // 交换出来再执行，缩小临界区
+        lock_guard<mutex> locker(mtx_);
+        functors.swap(pending_);
+    }
+    for(auto& cb : functors) { cb(); }
+}
+
+/**
+ * @brief 事件循环，结构与WebServer::Start()一致，只是读写不再交给线程池；
+ */
+void SubReactor::Loop_() {
+    // 先绑核，之后本线程初始化的连接缓冲区都分配在本地节点
+    if(cpu_ >= 0 && !CpuTopology::Instance()->Pin(cpu_)) {
+        LOG_WARN("Reactor[%d] failed to pin to cpu %d", id_, cpu_);
+    }
+    LOG_INFO("Reactor[%d] start, node %d", id_, CpuTopology::CurrentNode());
+    int timeMS = -1;
+    TimeService::Update();  // 本线程成为事件循环
+    while(!isClose_) {
+        if(timeoutMS_ > 0) {
+            timeMS = timer_->GetNextTick();
+        }
+        ReclaimFds_();  // 上一轮的事件都处理完了，关闭的描述符可以交还给内核
+        int eventCnt = epoller_->Wait(timeMS);
+        TimeService::Update();  // 每轮只读取一次时钟
+        for(int i = 0; i < eventCnt; i++) {
+            void* ptr = epoller_->GetEventPtr(i);
+            uint32_t events = epoller_->GetEvents(i);
+            if(ptr == &wakeupFd_) {
+                HandleWakeup_();
+                continue;
+            }
+            HttpConn* client = static_cast<HttpConn*>(ptr);
+            assert(client);
+            if(client->IsClose()) { continue; }     // 本轮前面的事件已经关闭了它，描述符还没释放，槽位不会被复用
+#ifdef WEBSERVER_COROUTINE
+            if(coroutine_) {   // 协程模式：只记录就绪事件，恢复正在等待的协程
+                WakeCo_(client, events);
+                continue;
+            }
+#endif
+            // 正在查询数据库，查询回来后发送响应时会发现挂断，持久模式下也会接着读取期间到达的请求
+            if(lane_[client->GetFd()] != LANE_NONE) { continue; }
+            if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                CloseConn_(client);
+            }
+            else if(persistent_) {  // 读写事件可能同时到来，先把积压的响应发出去再读
+                ExtentTime_(client);
+                if((events & EPOLLOUT) && client->ToWriteBytes() > 0) { OnWrite_(client); }
+                if((events & EPOLLIN) && !client->IsClose()) { OnRead_(client); }
+            }
+            else if(events & EPOLLIN) {
+                ExtentTime_(client);
+                OnRead_(client);
+            }
+            else if(events & EPOLLOUT) {
+                ExtentTime_(client);
+                OnWrite_(client);
+            } else {
+                LOG_ERROR("Unexpected event");
+            }
+        }
+    }
+    ReclaimFds_();
+    LOG_INFO("Reactor[%d] quit", id_);
+}
+
+/**
+ * @brief 在本线程中初始化新连接，注册定时器与读事件；
+ * @param fd 连接套接字；
+ * @param addr 客户端地址；
+ */
+void SubReactor::AddClient_(int fd, sockaddr_in addr) {
+    assert(fd > 0);
+    HttpConn* client = users_->Acquire(fd);
+    client->init(fd, addr);
+    ++connCount_;
+    if(busyPollUS_ > 0 && !Epoller::SetSockBusyPoll(fd, busyPollUS_)) {
+        LOG_DEBUG("Reactor[%d] Client[%d] SO_BUSY_POLL error:%d", id_, fd, errno);
+    }
+    if(timeoutMS_ > 0) {
+        timer_->add(client->Timer(), client->CheckDelayMS());
+    }
+    if(lane_.size() <= static_cast<size_t>(fd)) { lane_.resize(fd + 1); }
+    lane_[fd] = LANE_NONE;
+#ifdef WEBSERVER_COROUTINE
+    if(coroutine_) {   // 只注册一次读写事件(边缘触发)，之后由协程按需等待
+        if(co_.size() <= static_cast<size_t>(fd)) { co_.resize(fd + 1); }
+        co_[fd] = CoState();
+        epoller_->AddFd(fd, connEvent_ | EPOLLIN | EPOLLOUT | EPOLLET, client);
+        LOG_INFO("Reactor[%d] Client[%d] in!", id_, fd);
+        HandleConn_(client);    // 协程立即开始读取请求
+        return;
+    }
+#endif
+    // 持久模式下同时关注读写，边缘触发只在状态变化时通知，之后不需要再修改
+    epoller_->AddFd(fd, (persistent_ ? EPOLLIN | EPOLLOUT : EPOLLIN) | connEvent_, client);
+    LOG_INFO("Reactor[%d] Client[%d] in!", id_, fd);
+}
+
+/**
+ * @brief 关闭连接；描述符延迟到本轮事件处理完再释放：
+ * 描述符一释放就可能被主Reactor accept到并交给其他子Reactor，复用同一个槽位，
+ * 而本轮取回的事件里可能还有指向这个槽位的旧事件；
+ * @param client 指向一个http连接的指针；
+ */
+void SubReactor::CloseConn_(HttpConn* client) {
+    assert(client);
+    if(client->IsClose()) { return; }   // 已经关闭过
+    LOG_INFO("Reactor[%d] Client[%d] quit!", id_, client->GetFd());
+    timer_->cancel(client->Timer());    // 槽位之后可能交给其他Reactor，结点必须先从本线程的时间轮中摘下
+    epoller_->DelFd(client->GetFd());
+    client->Close(true);
+    retiredFds_.push_back(client->GetFd());
+    --connCount_;
+#ifdef WEBSERVER_COROUTINE
+    if(coroutine_) { co_[client->GetFd()] = CoState(); }
+#endif
+}
+
+/**
+ * @brief 定时器回调，连接当前阶段的期限未到则重新设定，到了则计数并关闭连接；
+ * 关闭连接时会取消定时器，因此到期的一定是本线程仍持有的连接；
+ * @param client 指向http连接的指针；
+ */
+void SubReactor::OnTimeout_(HttpConn* client) {
+    if(!isDraining_) {
+        if(client->PhaseRemainMS() > 0) {
+            timer_->add(client->Timer(), client->CheckDelayMS());
+            return;
+        }
+        Metrics::Instance()->Add(static_cast<Metrics::COUNTER>(Metrics::TIMEOUT_HEADER + static_cast<int>(client->Phase())));
+    }
+#ifdef WEBSERVER_COROUTINE
+    if(coroutine_) {   // 连接归协程所有，由它自己关闭
+        OnCoTimeout_(client);
+        return;
+    }
+#endif
+    if(lane_[client->GetFd()] != LANE_NONE) {   // 连接对象正被线程池使用，查询回来后再关闭
+        lane_[client->GetFd()] = LANE_TIMEOUT;
+        return;
+    }
+    CloseConn_(client);
+}
+
+/**
+ * @brief 释放已关闭连接的描述符；
+ */
+void SubReactor::ReclaimFds_() {
+    for(int fd : retiredFds_) { close(fd); }
+    retiredFds_.clear();
+}
+
+/**
+ * @brief 连接上有事件时按当前阶段的剩余时间重新设定定时器；
+ * @param client 指向要延长的http连接指针；
+ */
+void SubReactor::ExtentTime_(HttpConn* client) {
+    assert(client);
+    if(timeoutMS_ > 0 && !isDraining_) { timer_->adjust(client->Timer(), client->CheckDelayMS()); }
+}
+
+/**
+ * @brief 读取请求并就地处理；
+ * @param client 指向http连接的指针；
+ */
+void SubReactor::OnRead_(HttpConn* client) {
+    assert(client);
+    if(lane_[client->GetFd()] != LANE_NONE) { return; }     // 让出后排队期间连接交给了数据库查询
+    int readErrno = 0;
+    ssize_t ret = (client->*readFn_)(&readErrno);
+    if(ret <= 0 && readErrno != EAGAIN) {
+        CloseConn_(client);
+        return;
+    }
+    if(client->IsYield()) {
+        Yield_(client, false);
+        return;
+    }
+    if(persistent_ && client->ToWriteBytes() > 0) { return; }  // 上一个响应还没发完，新请求等发完后再处理
+    OnProcess_(client);
+}
+
+/**
+ * @brief 处理请求并直接发送响应，只有写不完时才借助EPOLLOUT；
+ * @param client 指向http连接的指针；
+ */
+void SubReactor::OnProcess_(HttpConn* client) {
+    while(client->Parse()) {
+        if(Respond_(client)) { return; }
+        if(!SendResponse_(client)) { return; }
+    }
+    if(!persistent_) { epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client); }
+}
+
+/**
+ * @brief Parse之后生成响应，需要查询数据库时交给dbPool_，不阻塞事件循环，逻辑与WebServer::Respond_一致；
+ * 线程池排满时只给这个请求回复503；
+ * @param client 指向http连接的指针；
+ * @return 连接交给了线程池时返回true，查询完成后由OnVerified_继续，否则响应已经写入缓冲区；
+ */
+bool SubReactor::Respond_(HttpConn* client) {
+    if(client->NeedVerify()) {
+        if(!dbPool_) {
+            client->Verify();
+        } else if(dbPool_->TrySubmit([this, client] {
+                    client->Verify();
+                    QueueInLoop([this, client] { OnVerified_(client); });
+                })) {
+            Metrics::Instance()->Add(Metrics::DB_LANE);
+            lane_[client->GetFd()] = LANE_BUSY;
+            // 查询期间不关注读写，条件触发下挂断也只通知一次，不会空转；持久模式不修改注册，期间的事件直接忽略
+            if(!persistent_) { epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLONESHOT, client); }
+            return true;
+        } else {
+            Metrics::Instance()->Add(Metrics::DB_SHED);
+            client->RespondBusy();
+            return false;
+        }
+    }
+    client->Respond();
+    return false;
+}
+
+/**
+ * @brief 数据库查询完成后在本线程继续：发送响应，再处理缓冲区中后续的请求；
+ * 查询期间连接不会被关闭，因此不需要检查代数；
+ * @param client 指向http连接的指针；
+ */
+void SubReactor::OnVerified_(HttpConn* client) {
+    uint8_t& lane = lane_[client->GetFd()];
+    bool timedOut = lane == LANE_TIMEOUT;
+    lane = LANE_NONE;
+    if(timedOut) {
+        CloseConn_(client);
+        return;
+    }
+    client->Respond();
+    if(SendResponse_(client)) { OnProcess_(client); }
+}
+
+/**
+ * @brief 发送响应，逻辑与WebServer::SendResponse_一致；
+ * @param client 指向http连接的指针；
+ * @return 响应已发完且连接仍然有效时返回true；
+ */
+bool SubReactor::SendResponse_(HttpConn* client) {
+    assert(client);
+    int writeErrno = 0;
+    ssize_t ret = (client->*writeFn_)(&writeErrno);
+    if(client->ToWriteBytes() > 0) {
+        if(client->IsYield()) {     // 用完写预算，套接字仍然可写
+            Yield_(client, true);
+        } else if(ret > 0 || writeErrno == EAGAIN) {
+            // 持久模式下套接字缓冲区腾出空间时会有EPOLLOUT边缘
+            if(!persistent_) { epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT, client); }
+        } else {
+            CloseConn_(client);
+        }
+        return false;
+    }
+    if(!client->IsKeepAlive() || isDraining_) {
+        CloseConn_(client);
+        return false;
+    }
+    int readErrno = 0;
+    ret = (client->*readFn_)(&readErrno);   // 推测性地读一次下一个请求
+    if(ret == 0 || (ret < 0 && readErrno != EAGAIN)) {
+        CloseConn_(client);
+        return false;
+    }
+    if(client->IsYield()) {
+        Yield_(client, false);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 连接用完了读写预算，排到本轮事件之后继续，让其他连接先得到处理；
+ * 条件触发下epoll还会继续通知，只需保证关注了相应事件；边缘触发不会再有通知，因此投递到事件循环的任务队列中；
+ * @param client 指向http连接的指针；
+ * @param isWrite 让出的是写(true)还是读(false)；
+ */
+void SubReactor::Yield_(HttpConn* client, bool isWrite) {
+    if(!(connEvent_ & EPOLLET)) {
+        epoller_->ModFd(client->GetFd(), connEvent_ | (isWrite ? EPOLLOUT : EPOLLIN), client);
+        return;
+    }
+    uint32_t gen = client->Gen();
+    QueueInLoop([this, client, gen, isWrite] {
+        if(client->Gen() != gen) { return; }    // 排队期间连接已经关闭
+        if(isWrite) { OnWrite_(client); }
+        else { OnRead_(client); }
+    });
+}
+
+/**
+ * @brief 可写事件触发时继续发送响应；
+ * @param client 指向http连接的指针；
+ */
+void SubReactor::OnWrite_(HttpConn* client) {
+    if(lane_[client->GetFd()] != LANE_NONE) { return; }     // 同OnRead_
+    if(SendResponse_(client)) { OnProcess_(client); }
+}
+
+#ifdef WEBSERVER_COROUTINE
+/**
+ * @brief 连接处理协程：读请求、(必要时在线程池中)查询数据库、发送响应，循环直到连接关闭；
+ * 需要等待时挂起，由事件循环(套接字就绪、超时)或线程池(查询完成)恢复，始终在本Reactor的线程中运行；
+ * @param client 指向http连接的指针；
+ */
+Task SubReactor::HandleConn_(HttpConn* client) {
+    int fd = client->GetFd();
+    while(true) {
+        int readErrno = 0;
+        ssize_t ret = client->read<EdgeTrigger>(&readErrno);
+        if(ret == 0 || (ret < 0 && readErrno != EAGAIN)) { break; }   // 对端关闭或出错
+        bool yield = client->IsYield();
+        if(!yield) { co_[fd].ready &= ~EPOLLIN; }   // 已经读到EAGAIN，等下一次边缘
+
+        while(client->Parse()) {
+            if(!client->NeedVerify()) {
+                client->Respond();
+            } else if(co_await OffloadAwaiter{this, [client] { client->Verify(); }}) {
+                // 查询数据库期间协程挂起，Reactor线程继续处理其他连接
+                Metrics::Instance()->Add(Metrics::DB_LANE);
+                client->Respond();
+            } else {    // 线程池排满了，只拒绝这个请求
+                Metrics::Instance()->Add(Metrics::DB_SHED);
+                client->RespondBusy();
+            }
+            while(client->ToWriteBytes() > 0) {
+                int writeErrno = 0;
+                ret = client->write<EdgeTrigger>(&writeErrno);
+                if(client->ToWriteBytes() == 0) { break; }
+                if(client->IsYield()) {     // 用完写预算，套接字仍然可写
+                    co_await PostAwaiter{this};
+                    continue;
+                }
+                if(ret < 0 && writeErrno != EAGAIN) {
+                    CloseConn_(client);
+                    co_return;
+                }
+                co_[fd].ready &= ~EPOLLOUT;
+                if(!co_await IoAwaiter{this, fd, EPOLLOUT}) {   // 发送超时
+                    CloseConn_(client);
+                    co_return;
+                }
+            }
+            if(!client->IsKeepAlive() || isDraining_) {
+                CloseConn_(client);
+                co_return;
+            }
+        }
+
+        if(yield) {
+            co_await PostAwaiter{this};
+        } else if(!co_await IoAwaiter{this, fd, EPOLLIN}) {  // 空闲超时
+            break;
+        }
+    }
+    CloseConn_(client);
+}
+
+/**
+ * @brief 协程模式下处理连接上的事件：记录就绪状态，协程正在等待这个事件则恢复它；
+ * @param client 指向http连接的指针；
+ * @param events 就绪的事件；
+ */
+void SubReactor::WakeCo_(HttpConn* client, uint32_t events) {
+    ExtentTime_(client);
+    CoState& st = co_[client->GetFd()];
+    if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) { events |= EPOLLIN | EPOLLOUT; }  // 交给read/write去发现错误
+    st.ready |= events & (EPOLLIN | EPOLLOUT);
+    if(st.want & st.ready) {
+        st.want = 0;
+        st.handle.resume();
+    }
+}
+
+/**
+ * @brief 协程模式下连接超时：正在等待就绪的协程立即恢复并关闭连接，
+ * 正在查询数据库的协程回来后，下一次等待时发现超时再关闭；
+ * @param client 指向http连接的指针；
+ */
+void SubReactor::OnCoTimeout_(HttpConn* client) {
+    CoState& st = co_[client->GetFd()];
+    st.timedOut = true;
+    if(st.want) {
+        st.want = 0;
+        st.handle.resume();
+    }
+}
+
+/**
+ * @brief 事件循环退出后、析构时调用，此时线程池已经销毁；
+ * 协程帧只在协程结束时释放，而挂起的协程要么等在co_中，要么等在pending_里投递回来的恢复任务上，
+ * 因此反复执行遗留的任务，并让等待就绪的协程以超时恢复，直到没有协程挂起：各协程关闭自己的连接后结束；
+ */
+void SubReactor::FinishCo_() {
+    dbPool_ = nullptr;  // 恢复后新的数据库请求直接回复503
+    isDraining_ = true; // 发完当前响应就关闭，不再处理后续请求
+    bool more = true;
+    while(more) {
+        more = false;
+        for(size_t fd = 0; fd < co_.size(); fd++) {
+            co_[fd].timedOut = true;    // 包括稍后才恢复的协程，下一次等待时直接返回
+            if(co_[fd].want) {
+                co_[fd].want = 0;
+                co_[fd].handle.resume();
+                more = true;
+            }
+        }
+        vector<Functor> functors;
+        {
+            lock_guard<mutex> locker(mtx_);
+            functors.swap(pending_);
+        }
+        for(auto& cb : functors) { cb(); }
+        more = more || !functors.empty();
+    }
+    ReclaimFds_();
+}
+#endif
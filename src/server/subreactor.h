@@ -0,0 +1,207 @@
+/*
+头文件介绍：
+- 子Reactor，一个线程一个事件循环(one loop per thread)；
+- 每个子Reactor拥有自己的IO后端(Poller)、时间轮定时器以及一部分连接，连接上的读写在本线程内完成；
+- 连接对象存放在所有Reactor共用的连接表中，描述符各不相同，因此各自访问自己的槽位即可；
+- 主Reactor(WebServer)只负责accept，新连接通过eventfd唤醒的方式交给子Reactor；
+*/
+#ifndef SUB_REACTOR_H
+#define SUB_REACTOR_H
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <sys/eventfd.h>    // eventfd()用于线程间唤醒
+#include <netinet/in.h>
+
+#include "poller.h"
+#include "epoller.h"    // 设置套接字的忙轮询选项
+#include "conntable.h"
+#include "../log_system/log.h"
+#include "../timer/timingwheel.h"
+#include "../http/httpconn.h"
+#include "../threadpool/threadpool.h"
+#include "../topology/cputopology.h"
+#ifdef WEBSERVER_COROUTINE
+#include "../coroutine/task.h"
+#endif
+
+class SubReactor {
+public:
+    typedef std::function<void()> Functor;  // 投递到事件循环中执行的任务
+
+    SubReactor(int id, int timeoutMS, uint32_t connEvent, int ioBackend, ConnTable* users,
+               bool persistent = false, int busyPollUS = 0, ThreadPool* dbPool = nullptr, bool coroutine = false,
+               int timerTickMS = 10, int cpu = -1);
+
+    ~SubReactor();
+
+    void Start();
+
+    void Stop();
+
+    void AddConn(int fd, const sockaddr_in& addr);
+
+    void QueueInLoop(Functor cb);
+
+    void Drain(int timeoutMS);
+
+    /**
+     * @brief 返回本Reactor当前持有的连接数，主Reactor据此做负载均衡；
+     */
+    int ConnCount() const { return connCount_; }
+
+    /**
+     * @brief 返回实际生效的忙轮询预算，打印日志用；
+     */
+    int BusyPollUS() const { return busyPollUS_; }
+
+private:
+    void Loop_();
+
+    void Wakeup_();
+
+    void HandleWakeup_();
+
+    void AddClient_(int fd, sockaddr_in addr);
+
+    void CloseConn_(HttpConn* client);
+
+    void OnTimeout_(HttpConn* client);
+
+    void ReclaimFds_();
+
+    void OnRead_(HttpConn* client);
+
+    void OnWrite_(HttpConn* client);
+
+    void OnProcess_(HttpConn* client);
+
+    bool Respond_(HttpConn* client);
+
+    void OnVerified_(HttpConn* client);
+
+    bool SendResponse_(HttpConn* client);
+
+    void Yield_(HttpConn* client, bool isWrite);
+
+    void ExtentTime_(HttpConn* client);
+
+#ifdef WEBSERVER_COROUTINE
+    /**
+     * @brief 协程模式下每个连接的等待状态，以描述符为下标；
+     */
+    struct CoState {
+        std::coroutine_handle<> handle; // 挂起等待就绪的协程
+        uint32_t want = 0;      // 正在等待的事件，0表示没有在等待
+        uint32_t ready = 0;     // 边缘触发报告过、还没读(写)到EAGAIN的事件
+        bool timedOut = false;  // 连接已经超时
+    };
+
+    /**
+     * @brief co_await等待套接字就绪，已经就绪则不挂起；
+     * @return 就绪返回true，连接超时返回false；
+     */
+    struct IoAwaiter {
+        SubReactor* loop;
+        int fd;
+        uint32_t events;
+
+        bool await_ready() const noexcept {
+            const CoState& st = loop->co_[fd];
+            return st.timedOut || (st.ready & events);
+        }
+        void await_suspend(std::coroutine_handle<> h) noexcept {
+            CoState& st = loop->co_[fd];
+            st.handle = h;
+            st.want = events;
+        }
+        bool await_resume() const noexcept { return !loop->co_[fd].timedOut; }
+    };
+
+    /**
+     * @brief co_await让出，排到本轮事件之后再继续，用于读写预算用完的情况；
+     */
+    struct PostAwaiter {
+        SubReactor* loop;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { loop->QueueInLoop([h] { h.resume(); }); }
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief co_await把可能阻塞的工作(查询数据库)交给线程池，完成后回到本Reactor的线程继续；
+     * 线程池的队列满了则不挂起，工作也不执行；
+     * @return 工作已执行返回true，队列满了返回false；
+     */
+    struct OffloadAwaiter {
+        SubReactor* loop;
+        Functor work;
+        bool submitted = false;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            SubReactor* self = loop;
+            // 恢复要经过QueueInLoop回到本线程，一定在这里返回之后，因此可以在提交后写submitted
+            // 析构时线程池已经销毁(dbPool_为空)，这时不再提交
+            submitted = loop->dbPool_ && loop->dbPool_->TrySubmit([self, h, fn = std::move(work)] {
+                fn();
+                self->QueueInLoop([h] { h.resume(); });
+            });
+            return submitted;
+        }
+        bool await_resume() const noexcept { return submitted; }
+    };
+
+    Task HandleConn_(HttpConn* client);
+
+    void WakeCo_(HttpConn* client, uint32_t events);
+
+    void OnCoTimeout_(HttpConn* client);
+
+    void FinishCo_();
+
+    std::vector<CoState> co_;   // 协程模式下各连接的等待状态
+#endif
+
+    int id_;            // Reactor编号，打印日志用
+    int timeoutMS_;     // 连接超时时间
+    uint32_t connEvent_;    // 连接事件，连接只属于本线程，因此不需要EPOLLONESHOT
+    bool persistent_;   // 连接注册一次EPOLLIN|EPOLLOUT(边缘触发)后不再修改
+    int busyPollUS_;    // 忙轮询预算，0表示关闭
+    int cpu_;           // 事件循环线程绑定的CPU，-1表示不绑定
+    ThreadPool* dbPool_;    // 查询数据库的请求交给这个线程池，完成后回到本线程发送响应，为空表示在本线程查询
+    bool coroutine_;    // 以协程方式处理连接
+    HttpConn::IoFunc readFn_;   // 按connEvent_的触发模式选定的读函数
+    HttpConn::IoFunc writeFn_;  // 按connEvent_的触发模式选定的写函数
+    std::atomic<bool> isClose_;
+    int wakeupFd_;      // 用于唤醒事件循环的eventfd
+    std::atomic<int> connCount_;    // 连接数
+    bool isDraining_;   // 排空阶段，只在本线程中访问
+
+    std::unique_ptr<Poller> epoller_;   // 本线程独占的IO后端
+    std::unique_ptr<TimingWheel> timer_;    // 本线程独占的定时器
+    std::vector<int> retiredFds_;   // 本轮关闭、尚未释放的描述符
+
+    /**
+     * @brief 非协程模式下连接与数据库查询的关系，以描述符为下标；
+     * 查询期间连接对象正被线程池使用，本线程不读写、不关闭它；
+     */
+    enum LANE_STATE : uint8_t {
+        LANE_NONE = 0,  // 没有在查询
+        LANE_BUSY,      // 正在线程池中查询
+        LANE_TIMEOUT,   // 查询期间超时，回来后直接关闭
+    };
+    std::vector<uint8_t> lane_;
+    ConnTable* users_;  // 连接表，由WebServer持有
+
+    std::mutex mtx_;    // 保护pending_
+    std::vector<Functor> pending_;  // 其他线程投递过来、等待在循环中执行的任务
+    std::thread thread_;
+};
+
+#endif //SUB_REACTOR_H
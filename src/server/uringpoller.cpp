@@ -0,0 +1,362 @@
+/*
+io_uring后端的具体实现：
+- user_data的高32位是注册序号，低32位是描述符，序号对不上的完成事件说明注册已经被修改或删除，直接丢弃；
+- 取消请求(POLL_REMOVE)的完成事件带有REMOVE_TAG标记，同样丢弃；
+- SQ/CQ的头尾指针与内核共享，按照io_uring的约定使用acquire/release语义访问；
+*/
+#include "uringpoller.h"
+
+namespace {
+const uint64_t REMOVE_TAG = 1ULL << 63;    // 取消请求的user_data标记
+
+/**
+ * @brief 把描述符与注册序号编码为user_data；
+ */
+inline uint64_t EncodeData(int fd, uint32_t seq) {
+    return (static_cast<uint64_t>(seq & 0x7fffffff) << 32) | static_cast<uint32_t>(fd);
+}
+}
+
+/**
+ * @brief 构造函数，初始化io_uring实例，失败时IsValid()返回false，由Poller::Create回退到epoll；
+ * @param maxEvent 单次Wait最多返回的事件数；
+ */
+UringPoller::UringPoller(int maxEvent):
+            ringFd_(-1), sqHead_(nullptr), sqTail_(nullptr), sqMask_(nullptr), sqArray_(nullptr),
+            sqEntries_(0), sqes_(nullptr), cqHead_(nullptr), cqTail_(nullptr), cqMask_(nullptr),
+            cqes_(nullptr), ringPtr_(nullptr), ringSize_(0), sqesSize_(0),
+            waiting_(false), waitId_(0), events_(maxEvent) {
+    assert(events_.size() > 0);
+    Setup_(static_cast<unsigned>(maxEvent) * 2);    // 每个事件最多对应一次取消加一次注册
+}
+
+/**
+ * @brief 析构函数，解除映射并关闭io_uring实例；
+ */
+UringPoller::~UringPoller() {
+    Release_();
+}
+
+/**
+ * @brief 创建io_uring实例并映射SQ、CQ与SQE数组；
+ * @param entries 期望的SQ长度；
+ * @return 初始化是否成功；
+ */
+bool UringPoller::Setup_(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CLAMP;  // 超出内核上限时自动截断
+    ringFd_ = syscall(__NR_io_uring_setup, entries, &params);
+    if(ringFd_ < 0) { return false; }
+
+    // 需要SQ/CQ共用映射(5.4)以及带超时的io_uring_enter(5.11)
+    if(!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        Release_();
+        return false;
+    }
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ringSize_ = sqSize > cqSize ? sqSize : cqSize;
+    ringPtr_ = mmap(nullptr, ringSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ringFd_, IORING_OFF_SQ_RING);
+    if(ringPtr_ == MAP_FAILED) {
+        ringPtr_ = nullptr;
+        Release_();
+        return false;
+    }
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ringFd_, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) {
+        Release_();
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* ring = static_cast<char*>(ringPtr_);
+    sqHead_ = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    sqEntries_ = params.sq_entries;
+    cqHead_ = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+    return true;
+}
+
+/**
+ * @brief 释放io_uring相关的全部资源；
+ */
+void UringPoller::Release_() {
+    if(sqes_) {
+        munmap(sqes_, sqesSize_);
+        sqes_ = nullptr;
+    }
+    if(ringPtr_) {
+        munmap(ringPtr_, ringSize_);
+        ringPtr_ = nullptr;
+    }
+    if(ringFd_ >= 0) {
+        close(ringFd_);
+        ringFd_ = -1;
+    }
+}
+
+/**
+ * @brief io_uring_enter系统调用的简单封装；
+ */
+int UringPoller::Enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    return syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize);
+}
+
+/**
+ * @brief 获取SQ中已放入但内核尚未取走的SQE数量；
+ */
+unsigned UringPoller::Pending_() const {
+    return *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief 立即提交SQ中的请求，调用时需持有锁；
+ */
+void UringPoller::SubmitLocked_() {
+    unsigned pending = Pending_();
+    if(pending > 0) {
+        Enter_(pending, 0, 0, nullptr, 0);
+    }
+}
+
+/**
+ * @brief 从SQ中取尾部一个空闲的SQE，SQ满了则先提交一次，调用时需持有锁；
+ * 此时尾指针还没有前移，内核看不到这个SQE，填好之后调用CommitSqe_发布；
+ * @return 清零后的SQE，取不到时返回nullptr；
+ */
+io_uring_sqe* UringPoller::GetSqe_() {
+    if(Pending_() >= sqEntries_) {
+        SubmitLocked_();
+        if(Pending_() >= sqEntries_) { return nullptr; }
+    }
+    unsigned idx = *sqTail_ & *sqMask_;
+    io_uring_sqe* sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[idx] = idx;
+    return sqe;
+}
+
+/**
+ * @brief 发布GetSqe_取到并已填好的SQE：尾指针以release语义前移，内核取到它时一定看到完整的内容，调用时需持有锁；
+ * Wait在锁外调用io_uring_enter，期间别的线程放入的SQE可能被这次调用一并提交，因此必须先填后发布；
+ */
+void UringPoller::CommitSqe_() {
+    __atomic_store_n(sqTail_, *sqTail_ + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 获取描述符的注册状态，数组不够长时扩容，调用时需持有锁；
+ */
+UringPoller::FdState& UringPoller::State_(int fd) {
+    if(static_cast<size_t>(fd) >= fds_.size()) {
+        fds_.resize(fd + 1024);
+    }
+    return fds_[fd];
+}
+
+/**
+ * @brief 按当前注册的事件放入一个POLL_ADD请求，调用时需持有锁；
+ * @param fd 文件描述符；
+ */
+void UringPoller::QueuePoll_(int fd) {
+    FdState& st = fds_[fd];
+    io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) { return; }
+    st.seq++;   // 新的注册，之前的完成事件全部作废
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // EPOLLONESHOT与EPOLLET是epoll_ctl的控制位，不属于poll的事件掩码
+    sqe->poll32_events = st.events & ~(EPOLLONESHOT | EPOLLET);
+    if((st.events & EPOLLET) && !(st.events & EPOLLONESHOT)) {
+        sqe->len = IORING_POLL_ADD_MULTI;   // 持久的边缘触发对应multishot poll
+    }
+    sqe->user_data = EncodeData(fd, st.seq);
+    CommitSqe_();
+    st.armed = true;
+}
+
+/**
+ * @brief 取消描述符上尚未结束的poll请求，调用时需持有锁；
+ * @param fd 文件描述符；
+ */
+void UringPoller::QueueRemove_(int fd) {
+    FdState& st = fds_[fd];
+    if(!st.armed) { return; }
+    io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) { return; }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->addr = EncodeData(fd, st.seq);
+    sqe->user_data = REMOVE_TAG;
+    CommitSqe_();
+    st.armed = false;
+}
+
+/**
+ * @brief 注册描述符，语义同epoll_ctl(EPOLL_CTL_ADD)；
+ * @param fd 要添加的文件描述符；
+ * @param events 关注的事件类型；
+ * @param ptr 事件就绪时返回的指针；
+ * @return 描述符的添加结果；
+ */
+bool UringPoller::AddFd(int fd, uint32_t events, void* ptr) {
+    if(fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState& st = State_(fd);
+    if(st.registered) return false;
+    st.registered = true;
+    st.armed = false;
+    st.events = events;
+    st.ptr = ptr;
+    QueuePoll_(fd);
+    if(waiting_) { SubmitLocked_(); }   // 有线程阻塞在Wait中，不能等到下一轮才提交
+    return true;
+}
+
+/**
+ * @brief 修改描述符关注的事件，语义同epoll_ctl(EPOLL_CTL_MOD)；
+ * @param fd 要修改的文件描述符；
+ * @param events 修改所关注的事件类型；
+ * @param ptr 事件就绪时返回的指针；
+ * @return 描述符的修改结果；
+ */
+bool UringPoller::ModFd(int fd, uint32_t events, void* ptr) {
+    if(fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState& st = State_(fd);
+    if(!st.registered) return false;
+    QueueRemove_(fd);
+    st.events = events;
+    st.ptr = ptr;
+    QueuePoll_(fd);
+    if(waiting_) { SubmitLocked_(); }
+    return true;
+}
+
+/**
+ * @brief 移除描述符，语义同epoll_ctl(EPOLL_CTL_DEL)；
+ * @param fd 要移除的文件描述符；
+ * @return 移除的结果；
+ */
+bool UringPoller::DelFd(int fd) {
+    if(fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState& st = State_(fd);
+    if(!st.registered) return false;
+    QueueRemove_(fd);
+    st.registered = false;
+    st.seq++;   // 已经产生的完成事件作废
+    if(waiting_) { SubmitLocked_(); }
+    return true;
+}
+
+/**
+ * @brief 提交积攒的请求并等待完成事件，一次io_uring_enter同时完成提交与等待；
+ * @param timeoutMs 阻塞的时间，单位毫秒，参数为-1表明无限等待；
+ * @return 就绪的文件描述符数量；
+ */
+int UringPoller::Wait(int timeoutMs) {
+    unsigned pending = 0;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        for(int fd : rearm_) {  // 上一轮触发过的条件触发描述符重新注册
+            FdState& st = fds_[fd];
+            if(st.registered && !st.armed && !(st.events & EPOLLONESHOT)) {
+                QueuePoll_(fd);
+            }
+        }
+        rearm_.clear();
+        pending = Pending_();
+        waiting_ = true;
+    }
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    unsigned minComplete = timeoutMs == 0 ? 0 : 1;
+    void* argPtr = nullptr;
+    size_t argSize = 0;
+    if(timeoutMs > 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        flags |= IORING_ENTER_EXT_ARG;
+        argPtr = &arg;
+        argSize = sizeof(arg);
+    }
+    Enter_(pending, minComplete, flags, argPtr, argSize);  // 超时(ETIME)或被信号打断时同样去收割
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    waiting_ = false;
+    return Reap_();
+}
+
+/**
+ * @brief 收割CQ中的完成事件，转换为epoll_event格式，调用时需持有锁；
+ * @return 本轮就绪的描述符数量；
+ */
+int UringPoller::Reap_() {
+    int n = 0;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    ++waitId_;
+    while(head != tail && n < static_cast<int>(events_.size())) {
+        const io_uring_cqe* cqe = &cqes_[head & *cqMask_];
+        uint64_t data = cqe->user_data;
+        int res = cqe->res;
+        uint32_t flags = cqe->flags;
+        head++;
+
+        if(data & REMOVE_TAG) continue;
+        int fd = static_cast<int>(data & 0xffffffff);
+        uint32_t seq = static_cast<uint32_t>(data >> 32);
+        if(static_cast<size_t>(fd) >= fds_.size()) continue;
+        FdState& st = fds_[fd];
+        if(!st.registered || (st.seq & 0x7fffffff) != seq) continue;  // 过期的完成事件
+
+        if(!(flags & IORING_CQE_F_MORE)) { // 这个poll请求已经结束
+            st.armed = false;
+            if(!(st.events & EPOLLONESHOT)) { rearm_.push_back(fd); }
+        }
+        uint32_t ev = res < 0 ? EPOLLERR : static_cast<uint32_t>(res);
+        if(st.waitId == waitId_) {  // multishot可能在同一轮产生多个事件，合并到一起
+            events_[st.slot].events |= ev;
+            continue;
+        }
+        st.waitId = waitId_;
+        st.slot = n;
+        events_[n].data.ptr = st.ptr;
+        events_[n].events = ev;
+        n++;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+/**
+ * @brief 获取事件数组指定位置的事件在注册时附带的指针；
+ * @return 注册时传入的指针；
+ */
+void* UringPoller::GetEventPtr(size_t i) const {
+    assert(i < events_.size());
+    return events_[i].data.ptr;
+}
+
+/**
+ * @brief 获取事件数组指定位置的事件；
+ * @return 事件信息；
+ */
+uint32_t UringPoller::GetEvents(size_t i) const {
+    assert(i < events_.size());
+    return events_[i].events;
+}
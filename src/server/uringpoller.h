@@ -0,0 +1,113 @@
+/*
+头文件介绍：
+- 基于io_uring的就绪通知后端(poll-notification)，直接使用io_uring_setup/io_uring_enter系统调用，不依赖liburing；
+- 只用POLL_ADD/POLL_REMOVE替代epoll_ctl/epoll_wait，连接的read/writev、accept4仍是普通的系统调用，不是io_uring的IO路径；
+- 就绪通知使用IORING_OP_POLL_ADD：
+    -- EPOLLONESHOT的注册对应单次poll，触发后需要上层ModFd重新注册，语义与epoll一致；
+    -- EPOLLET的持久注册对应multishot poll，内核持续产生完成事件；
+    -- 条件触发的持久注册使用单次poll，在下一次Wait时自动重新注册；
+- AddFd/ModFd/DelFd只是把SQE放进提交队列，和下一次Wait合并成一次io_uring_enter，省掉了每次epoll_ctl的系统调用；
+  ModFd对应一次取消加一次注册，两个SQE；
+*/
+#ifndef URING_POLLER_H
+#define URING_POLLER_H
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <assert.h>
+#include <string.h>
+#include <vector>
+#include <mutex>
+
+#include "poller.h"
+
+class UringPoller : public Poller {
+public:
+    explicit UringPoller(int maxEvent = 1024);
+
+    ~UringPoller();
+
+    bool IsValid() const { return ringFd_ >= 0; }
+
+    bool AddFd(int fd, uint32_t events, void* ptr) override;
+
+    bool ModFd(int fd, uint32_t events, void* ptr) override;
+
+    bool DelFd(int fd) override;
+
+    int Wait(int timeoutMs = -1) override;
+
+    void* GetEventPtr(size_t i) const override;
+
+    uint32_t GetEvents(size_t i) const override;
+
+    const char* Name() const override { return "io_uring-poll"; }
+
+private:
+    /**
+     * @brief 每个描述符的注册状态，seq用来识别已经失效的完成事件(描述符被修改、删除或复用)；
+     */
+    struct FdState {
+        uint32_t events = 0;    // 上层注册的事件(包括EPOLLONESHOT、EPOLLET)
+        void* ptr = nullptr;    // 上层注册时附带的指针
+        uint32_t seq = 0;       // 注册序号，编码进user_data
+        bool registered = false;    // 是否处于注册状态
+        bool armed = false;     // 内核中是否有尚未结束的poll请求
+        size_t slot = 0;        // 本轮Wait中该描述符在events_中的位置
+        uint64_t waitId = 0;    // 上次出现在哪一轮Wait中，用于合并同一轮的重复事件
+    };
+
+    bool Setup_(unsigned entries);
+
+    void Release_();
+
+    io_uring_sqe* GetSqe_();
+
+    void CommitSqe_();
+
+    unsigned Pending_() const;
+
+    void SubmitLocked_();
+
+    void QueuePoll_(int fd);
+
+    void QueueRemove_(int fd);
+
+    FdState& State_(int fd);
+
+    int Enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize);
+
+    int Reap_();
+
+    int ringFd_;    // io_uring实例的描述符
+
+    // 提交队列(SQ)
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned* sqMask_;
+    unsigned* sqArray_;
+    unsigned sqEntries_;
+    io_uring_sqe* sqes_;
+
+    // 完成队列(CQ)
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned* cqMask_;
+    io_uring_cqe* cqes_;
+
+    void* ringPtr_;     // SQ与CQ共用的映射区域
+    size_t ringSize_;
+    size_t sqesSize_;
+
+    bool waiting_;          // 是否有线程阻塞在Wait中，此时其他线程的修改需要立即提交
+    uint64_t waitId_;       // Wait的轮次
+
+    std::vector<FdState> fds_;      // 以描述符为下标的注册状态
+    std::vector<int> rearm_;        // 需要在下一次Wait时重新注册的条件触发描述符
+    std::vector<struct epoll_event> events_;    // 本轮就绪的事件，格式与epoll保持一致
+    std::mutex mtx_;    // 线程池模式下工作线程会调用ModFd，因此需要互斥
+};
+
+#endif //URING_POLLER_H
@@ -23,14 +23,31 @@ using namespace std;
  * @param openLog 日志开关；
  * @param logLevel 日志等级；
  * @param logQueSize 日志队列大小；
+ * @param config 扩展配置；
  */
 WebServer::WebServer(
             int port, int trigMode, int timeoutMS, bool OptLinger, 
             int sqlPort, const char* sqlUser, const  char* sqlPwd,
             const char* dbName, int connPoolNum, int threadNum,
-            bool openLog, int logLevel, int logQueSize):
-            port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
-            timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
+            bool openLog, int logLevel, int logQueSize, const ServerConfig& config):
+            port_(port), openLinger_(OptLinger), reusePort_(config.reusePort || config.workerId >= 0),
+            workerId_(config.workerId), timeoutMS_(timeoutMS), isClose_(false), inlineMode_(config.inlineMode), busyPollUS_(0),
+            loopCpu_(PinLoop_(config)),
+            listenFd_(-1), listenBacklog_(config.listenBacklog), acceptBudget_(max(config.acceptBudget, 1)),
+            deferAcceptS_(config.deferAcceptS), acceptPending_(false),
+            reserveFd_(open("/dev/null", O_RDONLY | O_CLOEXEC)), upgradeFd_(-1),
+            upgradePath_(config.workerId < 0 ? config.upgradePath : nullptr),   // 多进程模式下各进程共用端口，不做交接
+            drainTimeoutMS_(config.drainTimeoutMS), isDraining_(false),
+            metricsIntervalMS_(config.metricsIntervalMS),
+            threadpool_(new ThreadPool(threadNum, ThreadPool::QUEUE_CAPACITY, PinWorkers_(config.workerCpus),
+                                                 PoolScaling_(config))), dbpool_(DbLane_(config)),
+            codel_(config.codelTargetMS > 0 ? new CoDel(config.codelTargetMS * 1000LL, max(config.codelIntervalMS, 1) * 1000LL) : nullptr),
+            affinityDepth_(max(config.affinityDepth, 0)),
+            epoller_(Poller::Create(config.ioBackend)),
+            users_(new ConnTable(MAX_FD, config.connPrefault)),
+            timer_(new TimingWheel(config.timerTickMS, [this](TimerNode* node) {
+                OnTimeout_(static_cast<HttpConn*>(node->data));
+            })), nextReactor_(0)
     {
     // 获取当前工作目录绝对路径，在终端的哪个地方运行程序，就获取哪个地方的目录
     // 后续考虑更改为指定目录的方式    
@@ -41,6 +58,13 @@ WebServer::WebServer(
 
     HttpConn::userCount = 0;    // 用户连接的数量
     HttpConn::srcDir = srcDir_; // 给http资源目录赋路径
+    HttpConn::readBudget = max(config.readBudget, 0);
+    HttpConn::writeBudget = max(config.writeBudget, 0);
+    HttpRequest::maxHeaderBytes = max(config.maxHeaderBytes, 0);
+    HttpRequest::maxBodyBytes = max(config.maxBodyBytes, 0);
+    auto phaseMS = [timeoutMS](int ms) { return ms > 0 ? ms : timeoutMS; };   // 未单独设置的阶段沿用timeoutMS
+    HttpConn::SetPhaseTimeouts(phaseMS(config.headerTimeoutMS), phaseMS(config.bodyTimeoutMS),
+                               phaseMS(config.writeTimeoutMS), phaseMS(config.idleTimeoutMS));
 
     // 初始化用户连接池实例
     SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
@@ -48,18 +72,99 @@ WebServer::WebServer(
     InitEventMode_(trigMode);   // 初始化事件模式
     if(!InitSocket_()) { isClose_ = true; }  // 初始化成功，则表明连接已经建立
 
+    // 多Reactor模式：连接只属于一个子Reactor线程，不再需要EPOLLONESHOT
+    uint32_t subConnEvent = connEvent_ & ~EPOLLONESHOT;
+    bool persistent = config.persistentET && config.reactorNum > 0;
+    if(persistent) {    // 持久注册依赖边缘触发，连接都在子Reactor上，因此统一改为边缘触发
+        subConnEvent |= EPOLLET;
+    }
+    // 子Reactor上查询数据库的请求交给线程池，开了数据库通道就交给它，事件循环不会被查询阻塞
+    // 协程模式：子Reactor上的连接由协程处理，线程池只用来执行数据库查询
+    ThreadPool* subDbPool = dbpool_ ? dbpool_.get() : threadpool_.get();
+    bool coroutine = false;
+#ifdef WEBSERVER_COROUTINE
+    coroutine = config.coroutine;
+#endif
+    std::vector<int> loopCpus = CpuList_(config.reactorCpus);
+    for(int i = 0; i < config.reactorNum; i++) {
+        int busyPollUS = (i < 32 && (config.busyPollMask >> i & 1)) ? config.busyPollUS : 0;
+        int cpu = loopCpus.empty() ? -1 : loopCpus[i % loopCpus.size()];
+        reactors_.emplace_back(new SubReactor(i, timeoutMS_, subConnEvent, config.ioBackend, users_.get(),
+                                              persistent, busyPollUS, subDbPool, coroutine,
+                                              config.timerTickMS, cpu));
+    }
+    // 单Reactor模式下连接都在主循环，由第0位决定
+    if(reactors_.empty() && (config.busyPollMask & 1) && config.busyPollUS > 0
+            && epoller_->SetBusyPoll(config.busyPollUS)) {
+        busyPollUS_ = config.busyPollUS;
+    }
+
     if(openLog) {   // 如果开启了日志记录系统
-        Log::Instance()->init(logLevel, "./log", ".log", logQueSize);   // 初始化
+        // 多进程模式下每个工作进程写自己的日志文件，Log只保存了后缀的指针，因此使用静态缓冲区
+        static char suffix[32] = ".log";
+        if(workerId_ >= 0) { snprintf(suffix, sizeof(suffix), "_w%d.log", workerId_); }
+        Log::Instance()->init(logLevel, "./log", suffix, logQueSize);   // 初始化
         if(isClose_) { LOG_ERROR("========== Server init error!=========="); }  // 如果连接没有正常开启
         else {  // 如果正常开启
             LOG_INFO("========== Server init ==========");
-            LOG_INFO("Port:%d, OpenLinger: %s", port_, OptLinger? "true":"false");
+            LOG_INFO("Port:%d, OpenLinger: %s, ReusePort: %s", port_, OptLinger? "true":"false",
+                            reusePort_ ? "true" : "false");
+            if(workerId_ >= 0) { LOG_INFO("Worker: %d, pid: %d", workerId_, getpid()); }
             LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
                             (listenEvent_ & EPOLLET ? "ET": "LT"),
                             (connEvent_ & EPOLLET ? "ET": "LT"));
             LOG_INFO("LogSys level: %d", logLevel);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
             LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            if(threadpool_->MinThreads() < threadpool_->MaxThreads()) {
+                LOG_INFO("ThreadPool scaling: %zu-%zu threads, target wait %dms, idle retire %dms",
+                         threadpool_->MinThreads(), threadpool_->MaxThreads(), config.poolTargetWaitMS, config.poolIdleMS);
+            }
+            if(codel_) { LOG_INFO("Load shedding: queue delay target %dms, interval %dms", config.codelTargetMS, config.codelIntervalMS); }
+            if(affinityDepth_ > 0) { LOG_INFO("Connection affinity: home queue depth %zu", affinityDepth_); }
+            if(dbpool_) {
+                LOG_INFO("DB lane: %d threads, queue limit %zu, nice +%d", config.dbThreads,
+                         dbpool_->QueueCapacity(), max(config.dbNice, 0));
+            }
+            LOG_INFO("Reactor num: %d, poll backend: %s, persistent ET: %s", config.reactorNum, epoller_->Name(),
+                            persistent ? "true" : "false");
+            LOG_INFO("Conn table: %d slots, prefault: %s", MAX_FD, config.connPrefault ? "true" : "false");
+            LOG_INFO("Timer: timing wheel, tick %dms", config.timerTickMS);
+            if(timeoutMS_ > 0) {
+                LOG_INFO("Timeout: header %dms, body %dms, write %dms, idle %dms",
+                         phaseMS(config.headerTimeoutMS), phaseMS(config.bodyTimeoutMS),
+                         phaseMS(config.writeTimeoutMS), phaseMS(config.idleTimeoutMS));
+            }
+            for(auto& reactor : reactors_) {
+                if(reactor->BusyPollUS() > 0) { LOG_INFO("Reactor busy poll: %dus", reactor->BusyPollUS()); }
+            }
+            if(busyPollUS_ > 0) { LOG_INFO("Busy poll: %dus", busyPollUS_); }
+            unsigned spinning = busyPollUS_ > 0 ? 1 : 0;
+            for(auto& reactor : reactors_) { spinning += reactor->BusyPollUS() > 0; }
+            if(spinning > 0 && spinning >= std::thread::hardware_concurrency()) {   // 自旋的循环与工作线程、客户端争抢CPU，尾延迟反而变差
+                LOG_WARN("Busy poll: %u spinning loops on %u CPUs, tail latency will get worse",
+                         spinning, std::thread::hardware_concurrency());
+            }
+            LOG_INFO("Listen backlog: %d, accept budget: %d, defer accept: %ds", listenBacklog_, acceptBudget_, deferAcceptS_);
+            LOG_INFO("IO budget: read %zu bytes, write %zu bytes", HttpConn::readBudget, HttpConn::writeBudget);
+            LOG_INFO("Request limit: header %zu bytes, body %zu bytes", HttpRequest::maxHeaderBytes, HttpRequest::maxBodyBytes);
+            LOG_INFO("Inline mode: %s", inlineMode_ && reactors_.empty() ? "on" : "off");
+#ifdef WEBSERVER_COROUTINE
+            LOG_INFO("Coroutine mode: %s", coroutine && !reactors_.empty() ? "on" : "off");
+#else
+            if(config.coroutine) { LOG_WARN("Coroutine mode: not compiled, rebuild with -DENABLE_COROUTINE=ON"); }
+#endif
+            LOG_INFO("Hot upgrade: %s", upgradeFd_ >= 0 ? upgradePath_ : "off");
+            CpuTopology* topo = CpuTopology::Instance();
+            std::vector<int> workerCpus = CpuList_(config.workerCpus);
+            LOG_INFO("CPU topology: %s", topo->Describe().c_str());
+            if(config.reactorCpus && loopCpus.empty()) { LOG_WARN("Invalid reactorCpus \"%s\", loops unpinned", config.reactorCpus); }
+            if(config.workerCpus && workerCpus.empty()) { LOG_WARN("Invalid workerCpus \"%s\", workers unpinned", config.workerCpus); }
+            if(!loopCpus.empty() && loopCpu_ < 0) { LOG_WARN("Main loop failed to pin"); }
+            LOG_INFO("Placement(cpu/node): main loop %s, reactors %s, workers %s",
+                     loopCpu_ >= 0 ? topo->Placement(loopCpus, 1, config.reactorNum).c_str() : "unpinned",
+                     reactors_.empty() ? "-" : topo->Placement(loopCpus, reactors_.size()).c_str(),
+                     topo->Placement(workerCpus, threadNum).c_str());
         }
     }
 }
@@ -68,8 +173,22 @@ WebServer::WebServer(
  * @brief 析构函数，关闭套接字，关闭(数据库)连接，释放内存空间；
  */
 WebServer::~WebServer() {
-    close(listenFd_);   // 关闭套接字
+    if(listenFd_ >= 0) { close(listenFd_); }   // 关闭套接字，已经交给新进程的话这里是-1
+    if(reserveFd_ >= 0) { close(reserveFd_); }
+    if(upgradeFd_ >= 0) {   // 没有发生交接，路径仍归本进程所有
+        close(upgradeFd_);
+        unlink(upgradePath_);
+    }
     isClose_ = true;    // 服务器设定为关闭状态
+    // 先停下子Reactor的事件循环，之后不会再向线程池提交任务；对象暂时保留，线程池中的任务仍可向它们投递
+    for(auto& reactor : reactors_) { reactor->Stop(); }
+    // 数据库通道的任务执行完会交回threadpool_，所以先关闭它，之后threadpool_中新的数据库请求直接回复503
+    if(dbpool_) { dbpool_->Shutdown(); }
+    threadpool_.reset();    // 先等线程池中的任务执行完，它们可能还会把协程投递回子Reactor
+    dbpool_.reset();
+    retired_.Reclaim();     // 工作线程最后关闭的连接
+    reactors_.clear();  // 回收所有子Reactor
+    timer_.reset();     // 关闭后仍挂在时间轮上的结点嵌在连接中，先摘下再释放连接表
     free(srcDir_);  // 需要free吗？
     SqlConnPool::Instance()->ClosePool();   // 关闭数据库连接
 }
@@ -103,7 +222,9 @@ void WebServer::InitEventMode_(int trigMode) {  // 初始化事件模式(条件
         connEvent_ |= EPOLLET;
         break;
     }
-    HttpConn::isET = (connEvent_ & EPOLLET);    // 1 3可以保证使用边缘触发
+    // 1 3可以保证使用边缘触发，按触发模式选定连接读写函数的实例，读写循环里不再判断模式
+    readFn_ = HttpConn::Reader(connEvent_ & EPOLLET);
+    writeFn_ = HttpConn::Writer(connEvent_ & EPOLLET);
 }
 
 /**
@@ -112,34 +233,63 @@ void WebServer::InitEventMode_(int trigMode) {  // 初始化事件模式(条件
 void WebServer::Start() {
     int timeMS = -1;  // 阻塞等待，初始值
     if(!isClose_) { LOG_INFO("========== Server start =========="); }
+    for(auto& reactor : reactors_) { reactor->Start(); }  // 多Reactor模式下主线程只负责accept
+    TimeService::Update();  // 本线程成为事件循环，之后每轮只读取一次时钟
+    loopThread_ = std::this_thread::get_id();
+    nextReport_ = TimeService::Now() + MS(metricsIntervalMS_);
     while(!isClose_) {
+        timeMS = -1;
         if(timeoutMS_ > 0) {
             timeMS = timer_->GetNextTick(); // 获取下一个定时器的超时时间
         }
+        if(isDraining_) {   // 排空阶段：连接走完或到了截止时间就退出
+            int remain = DrainRemainMS_();
+            if(HttpConn::userCount == 0 || remain == 0) {
+                LOG_INFO("Drain finished, %d clients left", (int)HttpConn::userCount);
+                break;
+            }
+            // 子Reactor上的连接数变化不会唤醒主线程，因此定期醒来检查一下
+            remain = min(remain, 100);
+            timeMS = (timeMS < 0) ? remain : min(timeMS, remain);
+        }
+        if(metricsIntervalMS_ > 0) {
+            int remain = ReportMetrics_();
+            timeMS = (timeMS < 0) ? remain : min(timeMS, remain);
+        }
+        if(acceptPending_) { timeMS = 0; }  // 还有连接等着accept，只看一眼其他事件，不阻塞
+        retired_.Reclaim();     // 上一轮的事件都处理完了，关闭的描述符可以交还给内核
         int eventCnt = epoller_->Wait(timeMS);  // 等待，返回发生事件的数目(会按照数列索引的顺序逐个保存？)
+        TimeService::Update();  // 本轮的定时器、日志、响应都使用这个时间
+        if(acceptPending_) { DealListen_(); }   // 边缘触发不会再通知，需要主动继续
+        ThreadPool::Batch batch(threadpool_.get());     // 本轮分派的任务攒到一起提交，本轮结束时按任务数唤醒工作线程
         for(int i = 0; i < eventCnt; i++) {
             /* 处理事件 */
-            int fd = epoller_->GetEventFd(i);   // 获取描述符
+            void* ptr = epoller_->GetEventPtr(i);   // 注册时附带的指针
             uint32_t events = epoller_->GetEvents(i);   // 获取事件
-            if(fd == listenFd_) {   // 如果刚好是要监听的描述符
+            if(ptr == &listenFd_) { // 如果刚好是要监听的描述符
                 DealListen_();  // 处理监听
+                continue;
+            }
+            if(ptr == &upgradeFd_) {    // 新进程来取监听套接字
+                DealUpgrade_();
+                continue;
             }
-            else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {  // 如果遇到连接中断，连接关闭，连接错误，则关闭连接
-                assert(users_.count(fd) > 0);   // 这种情况下已经已经建立了连接，否则就是有问题；
-                CloseConn_(&users_[fd]);
+            HttpConn* client = static_cast<HttpConn*>(ptr); // 其余的都是连接，直接拿到连接对象，不需要查表
+            assert(client);
+            if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {  // 如果遇到连接中断，连接关闭，连接错误，则关闭连接
+                RequestClose_(client);
             }
             else if(events & EPOLLIN) { // 需要监听是否有进来的数据
-                assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]); // 处理读
+                DealRead_(client);  // 处理读
             }
             else if(events & EPOLLOUT) {    // 需要监听是否有传给客户端的数据 
-                assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);    // 处理写
+                DealWrite_(client); // 处理写
             } else {
                 LOG_ERROR("Unexpected event");  // 否则就是一些预期之外的事件了
             }
         }
     }
+    retired_.Reclaim();
 }
 
 /**
@@ -149,7 +299,7 @@ void WebServer::Start() {
  */
 void WebServer::SendError_(int fd, const char*info) {
     assert(fd > 0);
-    int ret = send(fd, info, strlen(info), 0);  // 返回错误信息给客户端
+    int ret = send(fd, info, strlen(info), MSG_NOSIGNAL | MSG_DONTWAIT);  // 返回错误信息给客户端，对端已关闭时不触发SIGPIPE
     if(ret < 0) {
         LOG_WARN("send error to client[%d] error!", fd);    // 错误信息没有成功发送
     }
@@ -157,14 +307,19 @@ void WebServer::SendError_(int fd, const char*info) {
 }
 
 /**
- * @brief 关闭连接；
+ * @brief 关闭连接，调用者必须是连接的占用者(多Reactor模式下是连接所在的线程)；
+ * 在主线程中关闭时同时取消定时器结点；工作线程不碰主线程的时间轮，结点留到超时或槽位被新连接复用时再处理；
+ * 描述符交给retired_，主循环处理完本轮事件再释放：工作线程可能在主循环处理本轮事件的途中关闭连接，
+ * 描述符立即释放的话，本轮后面accept到的新连接会复用它和它的槽位，本轮残留的旧事件(如EPOLLHUP)就会落到新连接上；
  * @param client 指向一个http连接的指针；
  */
 void WebServer::CloseConn_(HttpConn* client) {
     assert(client);
     LOG_INFO("Client[%d] quit!", client->GetFd());
+    if(timeoutMS_ > 0 && std::this_thread::get_id() == loopThread_) { timer_->cancel(client->Timer()); }
     epoller_->DelFd(client->GetFd());   // 从例程中删除相应套接字
-    client->Close();
+    client->Close(true);
+    retired_.Retire(client->GetFd());
 }
 
 /**
@@ -174,33 +329,147 @@ void WebServer::CloseConn_(HttpConn* client) {
  */
 void WebServer::AddClient_(int fd, sockaddr_in addr) {
     assert(fd > 0);
-    users_[fd].init(fd, addr);  // 初始化http连接；
+    HttpConn* client = users_->Acquire(fd); // 取出描述符对应的槽位，槽位对象是复用的
+    client->init(fd, addr);  // 初始化http连接；
     if(timeoutMS_ > 0) {    // 每个客户端初始的等待时间
-        // 下面这段代码传入了回调函数，该函数的作用是为了在超时后关闭某个连接
-        // 然后从原理层面要说的是bind的三个参数，其中第二个参数this指针是函数参数中的隐式参数，第三个参数才是我们要用到的
-        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseConn_, this, &users_[fd]));
+        // 定时器结点嵌在连接中，到期后由OnTimeout_检查连接所处阶段的期限
+        // 工作线程关闭连接时不碰主线程的时间轮，结点留到超时或槽位被新连接复用时再处理
+        timer_->add(client->Timer(), client->CheckDelayMS());
     }
-    epoller_->AddFd(fd, EPOLLIN | connEvent_);  // 监听读事件以及其他一些自定义的连接事件
-    SetFdNonblock(fd);  // 设置为非阻塞模式
-    LOG_INFO("Client[%d] in!", users_[fd].GetFd());
+    if(busyPollUS_ > 0 && !Epoller::SetSockBusyPoll(fd, busyPollUS_)) {
+        LOG_DEBUG("Client[%d] SO_BUSY_POLL error:%d", fd, errno);
+    }
+    epoller_->AddFd(fd, EPOLLIN | connEvent_, client);  // 监听读事件以及其他一些自定义的连接事件，accept4已设置非阻塞
+    LOG_INFO("Client[%d] in!", client->GetFd());
+}
+
+/**
+ * @brief 把新连接交给某个子Reactor，单Reactor模式下直接由本线程添加；
+ * @param fd 连接套接字描述符；
+ * @param addr 客户端地址信息；
+ */
+void WebServer::DispatchClient_(int fd, sockaddr_in addr) {
+    if(reactors_.empty()) {
+        AddClient_(fd, addr);
+        return;
+    }
+    // 轮询选出两个候选，取连接数较少的那个，避免长连接在某个Reactor上堆积
+    size_t n = reactors_.size();
+    SubReactor* first = reactors_[nextReactor_ % n].get();
+    SubReactor* second = reactors_[(nextReactor_ + 1) % n].get();
+    nextReactor_++;
+    (second->ConnCount() < first->ConnCount() ? second : first)->AddConn(fd, addr);
 }
 
 /**
- * @brief 处理服务器的监听事件，准备与客户端连接，这个循环一直不间断的工作，直到用户数量超限；
+ * @brief 过载时回复给客户端的响应，客户端可以据此稍后重试；
+ */
+static const char BUSY_RESPONSE[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                                    "Retry-After: 1\r\n"
+                                    "Content-Length: 0\r\n"
+                                    "Connection: close\r\n\r\n";
+
+/**
+ * @brief 处理服务器的监听事件，每次最多accept acceptBudget_个连接，避免连接突增时饿死已有连接；
+ * 预算用完时设置acceptPending_，主循环处理完本轮事件后会继续accept；
  */
 void WebServer::DealListen_() {
     struct sockaddr_in addr;    // 客户端的地址
-    socklen_t len = sizeof(addr);   // 字节长
-    do {
-        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len); // 用于数据I/O的套接字
-        if(fd <= 0) { return;}  // 失败，什么也不干
-        else if(HttpConn::userCount >= MAX_FD) {    // 用户数量太多了，超过了最大能处理的连接
-            SendError_(fd, "Server busy!");
+    acceptPending_ = false;
+    for(int i = 0; i < acceptBudget_; i++) {
+        socklen_t len = sizeof(addr);   // 字节长
+        // 直接拿到非阻塞、exec时关闭的套接字，省去一次fcntl
+        int fd = accept4(listenFd_, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) {
+            if((errno == EMFILE || errno == ENFILE) && RejectByReserve_()) { // 描述符耗尽，连接会一直留在队列里反复触发
+                continue;
+            }
+            return; // EAGAIN，队列已经空了
+        }
+        Metrics::Instance()->Add(Metrics::ACCEPTS);
+        if(HttpConn::userCount >= MAX_FD || fd >= MAX_FD) {    // 用户数量太多了，超过了最大能处理的连接(连接表也放不下)
+            SendError_(fd, BUSY_RESPONSE);
+            Metrics::Instance()->Add(Metrics::REJECTS);
             LOG_WARN("Clients is full!");
-            return;
+            continue;   // 继续把队列中的连接都拒绝掉，而不是让它们等到超时
         }
-        AddClient_(fd, addr);
-    } while(listenEvent_ & EPOLLET);    // 监听事件如果设定为了边缘触发，则循环监听
+        DispatchClient_(fd, addr);
+    }
+    acceptPending_ = true;
+}
+
+/**
+ * @brief 描述符耗尽时，先释放预留的描述符，accept一个连接回复503后关闭，再把预留的描述符占回来；
+ * 描述符耗尽时即使队列为空accept也会返回EMFILE，因此要以这里的accept结果判断队列是否还有连接；
+ * @return 确实拒绝了一个连接时返回true，队列已空或没有预留描述符时返回false；
+ */
+bool WebServer::RejectByReserve_() {
+    if(reserveFd_ < 0) { return false; }
+    close(reserveFd_);
+    int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd > 0) {
+        SendError_(fd, BUSY_RESPONSE);
+        Metrics::Instance()->Add(Metrics::REJECTS);
+        LOG_WARN("Too many open files!");
+    }
+    reserveFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return fd > 0;
+}
+
+/**
+ * @brief 新进程连上来时把监听套接字交出去，对方确认后停止accept并开始排空连接；
+ */
+void WebServer::DealUpgrade_() {
+    int fd = accept(upgradeFd_, nullptr, nullptr);
+    if(fd < 0) { return; }
+    if(!Handover::Send(fd, listenFd_)) {    // 交接失败，继续正常服务
+        LOG_WARN("Hand over listen socket failed!");
+        close(fd);
+        return;
+    }
+    close(fd);
+    // 监听套接字已经由新进程接管，本进程只关闭自己的这份引用，内核中的accept队列不受影响
+    epoller_->DelFd(listenFd_);
+    close(listenFd_);
+    listenFd_ = -1;
+    // 路径已经交给新进程重新绑定，这里不能unlink
+    epoller_->DelFd(upgradeFd_);
+    close(upgradeFd_);
+    upgradeFd_ = -1;
+    LOG_INFO("Listen socket handed over, draining...");
+    StartDrain_();
+}
+
+/**
+ * @brief 进入排空状态：长连接在当前响应发完后关闭，所有连接的超时时间不晚于截止时间；
+ */
+void WebServer::StartDrain_() {
+    drainDeadline_ = TimeService::Now() + MS(drainTimeoutMS_);
+    isDraining_ = true;
+    if(timeoutMS_ > 0) { timer_->shrink(drainTimeoutMS_); }
+    for(auto& reactor : reactors_) { reactor->Drain(drainTimeoutMS_); }
+}
+
+/**
+ * @brief 距离排空截止时间还剩多少毫秒；
+ */
+int WebServer::DrainRemainMS_() const {
+    auto remain = std::chrono::duration_cast<MS>(drainDeadline_ - TimeService::Now()).count();
+    return remain > 0 ? static_cast<int>(remain) : 0;
+}
+
+/**
+ * @brief 到了输出时间则把计数器写入日志；
+ * @return 距离下一次输出的毫秒数；
+ */
+int WebServer::ReportMetrics_() {
+    TimeStamp now = TimeService::Now();
+    if(now >= nextReport_) {
+        Metrics::Instance()->Report();
+        LOG_INFO("[metrics] pool threads: %zu, blocked: %d", threadpool_->ThreadCount(), threadpool_->BlockedCount());
+        nextReport_ = now + MS(metricsIntervalMS_);
+    }
+    return static_cast<int>(std::chrono::duration_cast<MS>(nextReport_ - now).count());
 }
 
 /**
@@ -210,8 +479,19 @@ void WebServer::DealListen_() {
 void WebServer::DealRead_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);    // 更新超时时间
+    // 重新注册后事件可能在工作线程放手之前就到了，这时留给它接着处理
+    if(!client->TryOwn(HttpConn::PEND_IN)) { return; }
+    if(client->IsClose()) {     // 同一批事件里前面已经关闭了它
+        client->Disown();
+        return;
+    }
+    if(inlineMode_) {   // 在本线程内完成，省去一次线程切换
+        uint32_t gen = client->Gen();
+        if(!OnReadInline_(client) && client->Gen() == gen) { client->Disown(); }
+        return;
+    }
     // 用线程处理下面的读任务，实现并发处理
-    threadpool_->submit(std::bind(&WebServer::OnRead_, this, client));
+    Dispatch_(client, &WebServer::OnRead_);
 }
 
 /**
@@ -221,71 +501,295 @@ void WebServer::DealRead_(HttpConn* client) {
 void WebServer::DealWrite_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);    // 给响应的连接设置超时时间
+    if(!client->TryOwn(HttpConn::PEND_OUT)) { return; }
+    if(client->IsClose()) {
+        client->Disown();
+        return;
+    }
+    if(inlineMode_ && client->IsFileResident()) {   // 续写的文件仍在页缓存中，直接发送
+        uint32_t gen = client->Gen();
+        bool handed = SendResponse_(client) && OnProcessInline_(client);
+        if(!handed && client->Gen() == gen) { client->Disown(); }
+        return;
+    }
     // 用线程处理下面的写入任务
-    threadpool_->submit(std::bind(&WebServer::OnWrite_, this, client));
+    Dispatch_(client, &WebServer::OnWrite_);
+}
+
+/**
+ * @brief 把(处理函数, 连接)交给线程池；lambda只捕获两个指针和一个成员函数指针，
+ * 可平凡拷贝，直接放在任务内部，提交、出队、执行都不分配内存；
+ * 按连接分派时以描述符为键，同一连接的事件总在同一个工作线程处理，缓冲区和请求状态不在CPU缓存之间来回搬；
+ * @param client 已被占用的http连接；
+ * @param handler 要执行的处理函数；
+ */
+void WebServer::Dispatch_(HttpConn* client, Handler handler) {
+    int64_t stampUS = TimeService::SteadyUS();  // 用单调时钟，墙上时间跳变不会让排队时间变成几小时或负数
+    auto task = [this, client, handler, stampUS] { RunOwned_(client, Admit_(handler, stampUS)); };
+    if(affinityDepth_ > 0) { threadpool_->SubmitTo(static_cast<size_t>(client->GetFd()), affinityDepth_, task); }
+    else { threadpool_->submit(task); }
+}
+
+/**
+ * @brief 任务出队时调用，记录排队时间；线程池持续积压(由codel_判断)时，排队过久的请求改为快速回复503；
+ * 正在发送的响应(OnWrite_)已经投入了工作，不丢弃；
+ * @param handler 任务原本要执行的处理函数；
+ * @param stampUS 任务的提交时间；
+ * @return 实际要执行的处理函数，丢弃时为OnShed_；
+ */
+WebServer::Handler WebServer::Admit_(Handler handler, int64_t stampUS) {
+    int64_t nowUS = TimeService::SteadyUS();
+    int64_t sojournUS = nowUS - stampUS;
+    Metrics::Instance()->Observe(Metrics::QUEUE_DELAY, sojournUS);
+    if(!codel_ || !codel_->Shed(sojournUS, nowUS) || handler == &WebServer::OnWrite_) { return handler; }
+    return &WebServer::OnShed_;
+}
+
+/**
+ * @brief 丢弃请求：照常读取并解析(开销很小)，不生成响应，直接回复503，连接保持不变；
+ * 不直接关闭连接，否则请求体等还没读到的数据会让内核回复RST，客户端可能连503都收不到；
+ * @param client 指向http连接的指针；
+ * @return 连接交给了数据库通道(占用随之转交)时返回true；
+ */
+bool WebServer::OnShed_(HttpConn* client) {
+    int readErrno = 0;
+    ssize_t ret = (client->*readFn_)(&readErrno);
+    if(ret <= 0 && readErrno != EAGAIN) {
+        CloseConn_(client);
+        return false;
+    }
+    if(!client->Parse()) {  // 请求还没收全，等收全之后照常处理
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);
+        return false;
+    }
+    Metrics::Instance()->Add(Metrics::CODEL_SHED);
+    client->RespondBusy();
+    return SendResponse_(client) && OnProcess(client);
 }
 
 /**
- * @brief 延长超时时间；
+ * @brief 线程池任务的入口，调用时连接已被本任务占用：先执行handler，
+ * 再处理占用期间留下的事件或关闭请求，全部处理完才释放占用；
+ * handler把连接交给了另一个任务(如数据库通道)时占用随之转交，这里不再碰它；
+ * 连接在处理过程中被关闭后槽位可能马上属于新连接，因此以代数判断，不再碰它；
+ * @param client 指向http连接的指针；
+ * @param handler 要执行的处理函数，返回true表示连接已交给其他任务；
+ */
+void WebServer::RunOwned_(HttpConn* client, Handler handler) {
+    uint32_t gen = client->Gen();
+    if((this->*handler)(client)) { return; }
+    while(client->Gen() == gen) {
+        uint32_t flags = client->Release();
+        if(!flags) { return; }
+        if(flags & HttpConn::CLOSE_REQ) {
+            CloseConn_(client);
+            return;
+        }
+        bool handed = (flags & HttpConn::PEND_OUT) ? OnWrite_(client) : OnRead_(client);
+        if(handed) { return; }
+    }
+}
+
+/**
+ * @brief 主线程请求关闭连接(超时或对端挂断)，连接正被工作线程占用时由它处理完后关闭；
+ * 已关闭连接的描述符在本轮事件处理完之前不会释放，槽位不会被新连接复用，残留的旧事件只会看到已关闭的连接；
+ * @param client 指向http连接的指针；
+ */
+void WebServer::RequestClose_(HttpConn* client) {
+    if(client->IsClose()) { return; }
+    if(!client->TryOwn(HttpConn::CLOSE_REQ)) { return; }
+    if(client->IsClose()) {  // 占用之前刚被工作线程关闭，或是关闭后残留的旧事件
+        client->Disown();
+        return;
+    }
+    CloseConn_(client);
+}
+
+/**
+ * @brief 连接上有事件时重新设定定时器，按连接当前阶段的剩余时间计算，头部阶段收到数据并不会延长期限；
  * @param client 指向要延长的http连接指针；
  */
 void WebServer::ExtentTime_(HttpConn* client) {
     assert(client);
-    if(timeoutMS_ > 0) { timer_->adjust(client->GetFd(), timeoutMS_); }
+    if(timeoutMS_ > 0 && !isDraining_) { timer_->adjust(client->Timer(), client->CheckDelayMS()); }  // 排空阶段不再延长
+}
+
+/**
+ * @brief 定时器回调：连接当前阶段的期限未到(阶段在工作线程中切换过)则重新设定，到了则计数并关闭；
+ * @param client 指向http连接的指针；
+ */
+void WebServer::OnTimeout_(HttpConn* client) {
+    if(client->IsClose()) { return; }   // 工作线程已经关闭了它，残留的结点
+    if(!isDraining_) {  // 排空阶段的期限由shrink统一设定，到期直接关闭
+        if(client->PhaseRemainMS() > 0) {
+            timer_->add(client->Timer(), client->CheckDelayMS());
+            return;
+        }
+        Metrics::Instance()->Add(static_cast<Metrics::COUNTER>(Metrics::TIMEOUT_HEADER + static_cast<int>(client->Phase())));
+    }
+    RequestClose_(client);
 }
 
 /**
  * @brief 服务器的数据读取过程(但同时也包含了将要发送的信息写入缓冲区的过程)；
  * @param client 指向http连接的指针；
+ * @return 连接交给了数据库通道(占用随之转交)时返回true；
  */
-void WebServer::OnRead_(HttpConn* client) {
+bool WebServer::OnRead_(HttpConn* client) {
     assert(client);
     int ret = -1;
     int readErrno = 0;
-    ret = client->read(&readErrno); // http连接要读取的是来自客户端的请求；
+    ret = (client->*readFn_)(&readErrno); // http连接要读取的是来自客户端的请求；
     if(ret <= 0 && readErrno != EAGAIN) {   // EAGAIN表示阻塞，表示无法立即完成，但稍后可能成功；
         CloseConn_(client); // 关闭客户端，因为没读到；
-        return;
+        return false;
+    }
+    if(client->IsYield()) { // 读够了预算，重新注册后由epoll再次分派，把线程让给其他连接
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);
+        return false;
     }
-    OnProcess(client);  // 设定监视状态；
+    return OnProcess(client);  // 设定监视状态；
 }
 
 /**
- * @brief 针对http的处理结果做相应的监听操作；
+ * @brief 在主线程内读取请求，然后就地处理；
  * @param client 指向http连接的指针；
+ * @return 连接交给了线程池(占用随之转交)时返回true；
  */
-void WebServer::OnProcess(HttpConn* client) {
-    if(client->process()) { // 客户端将数据写入了缓冲区，根据这个环节成功与否处理监听方式
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);    // 向缓冲区写入完成，准备发送了；
-    } else {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);     // 写入没成功，因此还是需要关注读事件；
+bool WebServer::OnReadInline_(HttpConn* client) {
+    assert(client);
+    int readErrno = 0;
+    ssize_t ret = (client->*readFn_)(&readErrno);
+    if(ret <= 0 && readErrno != EAGAIN) {
+        CloseConn_(client);
+        return false;
     }
+    if(client->IsYield()) {
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);
+        return false;
+    }
+    return OnProcessInline_(client);
+}
+
+/**
+ * @brief 在主线程内处理请求并发送响应，可能阻塞的环节交给线程池：
+ * 非GET请求(可能查询数据库)整个处理交给线程池，开了数据库通道时只把查询交给数据库通道，
+ * 文件不在页缓存中的响应把发送交给线程池；
+ * @param client 指向http连接的指针；
+ * @return 连接交给了线程池(占用随之转交)时返回true；
+ */
+bool WebServer::OnProcessInline_(HttpConn* client) {
+    while(true) {
+        if(!dbpool_ && client->MayBlock()) {
+            Dispatch_(client, &WebServer::OnProcess);
+            return true;
+        }
+        if(!client->Parse()) {    // 没有完整的请求，继续等待读
+            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);
+            return false;
+        }
+        if(Respond_(client)) { return true; }
+        if(!client->IsFileResident()) { // 冷文件，发送时会因缺页读磁盘
+            Dispatch_(client, &WebServer::OnWrite_);
+            return true;
+        }
+        if(!SendResponse_(client)) { return false; }  // 写不完会注册EPOLLOUT
+    }
+}
+
+/**
+ * @brief 处理请求，生成响应后直接发送，不再先注册EPOLLOUT等一轮epoll_wait；
+ * 长连接上已经读到的后续请求在循环中依次处理，读不到新请求时才回到epoll等待读事件；
+ * @param client 指向http连接的指针；
+ * @return 连接交给了数据库通道(占用随之转交)时返回true；
+ */
+bool WebServer::OnProcess(HttpConn* client) {
+    while(client->Parse()) {
+        if(Respond_(client)) { return true; }
+        if(!SendResponse_(client)) { return false; }
+    }
+    epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);     // 没有完整的请求，还是需要关注读事件；
+    return false;
+}
+
+/**
+ * @brief Parse之后生成响应：需要查询数据库时，开了数据库通道就把连接交给它，没开就在当前线程查询；
+ * 数据库通道排满时只给这个请求回复503，静态请求和其他连接不受影响；
+ * @param client 指向http连接的指针；
+ * @return 连接交给了数据库通道(占用随之转交)时返回true，否则响应已经写入缓冲区；
+ */
+bool WebServer::Respond_(HttpConn* client) {
+    if(client->NeedVerify()) {
+        if(!dbpool_) {
+            client->Verify();
+        } else if(dbpool_->TrySubmit([this, client] { RunOwned_(client, &WebServer::OnVerify_); })) {
+            Metrics::Instance()->Add(Metrics::DB_LANE);
+            return true;
+        } else {
+            Metrics::Instance()->Add(Metrics::DB_SHED);
+            client->RespondBusy();
+            return false;
+        }
+    }
+    client->Respond();
+    return false;
 }
 
 /**
- * @brief 将缓冲区的数据发送到客户端；
+ * @brief 数据库通道中执行：查询数据库生成响应，发送以及之后的请求交回threadpool_，数据库通道只做查询；
  * @param client 指向http连接的指针；
+ * @return 总是返回true，占用随任务转交给threadpool_；
  */
-void WebServer::OnWrite_(HttpConn* client) {
+bool WebServer::OnVerify_(HttpConn* client) {
+    client->Verify();
+    client->Respond();
+    Dispatch_(client, &WebServer::OnWrite_);
+    return true;
+}
+
+/**
+ * @brief 发送缓冲区中的响应，发完之后如果是长连接，顺便试着读一次下一个请求；
+ * @param client 指向http连接的指针；
+ * @return 响应已发完且连接仍然有效时返回true，此时应继续处理；已关闭连接或注册了EPOLLOUT时返回false；
+ */
+bool WebServer::SendResponse_(HttpConn* client) {
     assert(client);
-    int ret = -1;
     int writeErrno = 0;
-    ret = client->write(&writeErrno);
-    if(client->ToWriteBytes() == 0) {   // 如果写完了
-        /* 传输完成 */
-        if(client->IsKeepAlive()) { // 保持连接表明暂时先不断开
-            OnProcess(client);  // 继续处理(即设定监听状态)
-            return;
+    ssize_t ret = (client->*writeFn_)(&writeErrno);
+    if(client->ToWriteBytes() > 0) {    // 没写完
+        // 套接字缓冲区满了，这时才需要epoll通知可写；用完写预算时套接字仍可写，ONESHOT重新注册后会立即再次分派
+        if(ret > 0 || writeErrno == EAGAIN) {
+            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT, client);
+        } else {
+            CloseConn_(client);
         }
+        return false;
     }
-    else if(ret < 0) {  // 如果没写完，且返回的值异常
-        if(writeErrno == EAGAIN) {  // 如果只是由于延迟而产生的异常，则试着继续写(就是将该错误放行的意思)
-            /* 继续传输 */
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
-            return;
-        }
+    if(!client->IsKeepAlive() || isDraining_) { // 短连接(或排空阶段)发完就关
+        CloseConn_(client);
+        return false;
+    }
+    // 下一个请求往往已经到了，先读一次，读不到(EAGAIN)再回到epoll
+    int readErrno = 0;
+    ret = (client->*readFn_)(&readErrno);
+    if(ret == 0 || (ret < 0 && readErrno != EAGAIN)) {
+        CloseConn_(client);
+        return false;
     }
-    CloseConn_(client); // 最终关闭连接
+    if(client->IsYield()) {
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 将缓冲区的数据发送到客户端(EPOLLOUT触发时调用)；
+ * @param client 指向http连接的指针；
+ * @return 连接交给了数据库通道(占用随之转交)时返回true；
+ */
+bool WebServer::OnWrite_(HttpConn* client) {
+    return SendResponse_(client) && OnProcess(client);
 }
 
 /**
@@ -294,12 +798,53 @@ void WebServer::OnWrite_(HttpConn* client) {
  */
 bool WebServer::InitSocket_() {
     int ret;    // 承接各函数的返回值
-    struct sockaddr_in addr;    // 地址族信息
     if(port_ > 65535 || port_ < 1024) { // 锁定端口
         LOG_ERROR("Port:%d error!",  port_);
         return false;
     }
 
+    // 开启了热升级时，先看看有没有旧进程可以交出监听套接字，有的话直接沿用，accept队列中的连接不会丢失
+    listenFd_ = upgradePath_ ? Handover::Fetch(upgradePath_) : -1;
+    if(listenFd_ >= 0) {
+        LOG_INFO("Listen socket inherited from old process");
+    } else if(!BindListen_()) {
+        listenFd_ = -1;
+        return false;
+    }
+
+    // 使用 listenEvent_ | EPOLLIN 的位运算操作可以将读取事件添加到已有的标志中，实现同时监听读取事件和其他事件的功能。
+    // 如果没有使用位运算的或运算符|，而是直接使用单个事件标志，那么将只监听该单个事件，而不会同时监听其他事件。这可能会导致丢失其他事件的通知或处理。
+    // 使用listenEvent_ | EPOLLIN的位运算操作的意义在于将读取事件添加到已有的epoll事件标志中，实现同时监听多个事件的功能。
+    ret = epoller_->AddFd(listenFd_,  listenEvent_ | EPOLLIN, &listenFd_);  // epoll例程与套接字描述符绑定在一起，用&listenFd_标识监听事件
+    if(ret == 0) {
+        LOG_ERROR("Add listen error!");
+        close(listenFd_);   // 这一步很细节，需要关闭这段
+        listenFd_ = -1;
+        return false;
+    }
+
+    SetFdNonblock(listenFd_);   // 设定为非阻塞模式
+
+    if(upgradePath_) {  // 等待下一个新进程来取监听套接字
+        upgradeFd_ = Handover::Listen(upgradePath_);
+        if(upgradeFd_ < 0 || !epoller_->AddFd(upgradeFd_, EPOLLIN, &upgradeFd_)) {
+            LOG_WARN("Listen upgrade path %s error!", upgradePath_);
+            if(upgradeFd_ >= 0) { close(upgradeFd_); }
+            upgradeFd_ = -1;
+        }
+    }
+
+    LOG_INFO("Server port:%d", port_);  // 记录信息
+    return true;
+}
+
+/**
+ * @brief 创建监听套接字，设置选项后绑定端口并开始监听；
+ * @return 创建的结果，失败时套接字已关闭；
+ */
+bool WebServer::BindListen_() {
+    int ret;    // 承接各函数的返回值
+    struct sockaddr_in addr;    // 地址族信息
     addr.sin_family = AF_INET;  // 设定地址族为IPv4
     addr.sin_addr.s_addr = htonl(INADDR_ANY);   // 服务端随机分配IP，从主机字节序转换成网络字节序
     addr.sin_port = htons(port_);   // 将一个16位从主机字节序转换为网络字节序
@@ -334,6 +879,13 @@ bool WebServer::InitSocket_() {
         return false;
     }
 
+    // 多个进程各自绑定同一端口，由内核按四元组哈希分配新连接
+    if(reusePort_ && setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT, (const void*)&optval, sizeof(int)) == -1) {
+        LOG_ERROR("set SO_REUSEPORT error !");
+        close(listenFd_);
+        return false;
+    }
+
     // 绑定端口与ID
     ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));  // 给套接字描述符绑定地址信息
     if(ret < 0) {
@@ -342,25 +894,17 @@ bool WebServer::InitSocket_() {
         return false;
     }
 
-    ret = listen(listenFd_, 6); // 等待连接请求状态(设置为可以使6个连接请求进入队列)
+    ret = listen(listenFd_, listenBacklog_); // 等待连接请求状态(积压队列长度可配置，原来的6在连接突增时立刻溢出)
     if(ret < 0) {
         LOG_ERROR("Listen port:%d error!", port_);
         close(listenFd_);
         return false;
     }
-    // 使用 listenEvent_ | EPOLLIN 的位运算操作可以将读取事件添加到已有的标志中，实现同时监听读取事件和其他事件的功能。
-    // 如果没有使用位运算的或运算符|，而是直接使用单个事件标志，那么将只监听该单个事件，而不会同时监听其他事件。这可能会导致丢失其他事件的通知或处理。
-    // 使用listenEvent_ | EPOLLIN的位运算操作的意义在于将读取事件添加到已有的epoll事件标志中，实现同时监听多个事件的功能。
-    ret = epoller_->AddFd(listenFd_,  listenEvent_ | EPOLLIN);  // epoll例程与套接字描述符绑定在一起
-    if(ret == 0) {
-        LOG_ERROR("Add listen error!");
-        close(listenFd_);   // 这一步很细节，需要关闭这段
-        return false;
-    }
-
-    SetFdNonblock(listenFd_);   // 设定为非阻塞模式
 
-    LOG_INFO("Server port:%d", port_);  // 记录信息
+    // 客户端发来请求数据后才唤醒accept，只建立连接不发数据的客户端不会占用连接对象
+    if(deferAcceptS_ > 0 && setsockopt(listenFd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferAcceptS_, sizeof(deferAcceptS_)) < 0) {
+        LOG_WARN("set TCP_DEFER_ACCEPT error!");
+    }
     return true;
 }
 
@@ -377,4 +921,71 @@ int WebServer::SetFdNonblock(int fd) {
     // return fcntl(fd, F_SETFL, O_NONBLOCK);
     // 同时修复错误，需要获取的是套接字描述符的文件阻塞状态；F_GETFD->F_GETFL
     return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
-}
\ No newline at end of file
+}
+/**
+ * @brief 解析并检查CPU列表；
+ * @param list CPU列表字符串，可以为nullptr；
+ * @return 列表为空、格式错误或含有不可用的CPU时返回空数组，表示不绑定；
+ */
+std::vector<int> WebServer::CpuList_(const char* list) {
+    std::vector<int> cpus;
+    if(!list || !CpuTopology::ParseList(list, &cpus) || !CpuTopology::Instance()->Valid(cpus)) { cpus.clear(); }
+    return cpus;
+}
+
+/**
+ * @brief 把构造WebServer的线程(即之后运行主循环的线程)绑定到reactorCpus中的第reactorNum个；
+ * 在成员初始化列表的最前面调用，连接表等随后分配的内存因此落在主循环所在的节点上；
+ * @param config 扩展配置；
+ * @return 绑定的CPU，未绑定时返回-1；
+ */
+int WebServer::PinLoop_(const ServerConfig& config) {
+    CpuTopology* topo = CpuTopology::Instance();    // 先读取拓扑，取得绑核前进程允许的CPU
+    std::vector<int> cpus = CpuList_(config.reactorCpus);
+    if(cpus.empty()) { return -1; }
+    int cpu = cpus[config.reactorNum % cpus.size()];
+    return topo->Pin(cpu) ? cpu : -1;
+}
+
+/**
+ * @brief 生成工作线程的启动回调：第k个工作线程绑定到列表中的第k个CPU(按长度取模)；
+ * @param list CPU列表字符串；
+ * @return 不绑定时返回空回调；
+ */
+ThreadPool::ThreadInit WebServer::PinWorkers_(const char* list) {
+    std::vector<int> cpus = CpuList_(list);
+    if(cpus.empty()) { return nullptr; }
+    return [cpus](size_t index) { CpuTopology::Instance()->Pin(cpus[index % cpus.size()]); };
+}
+
+/**
+ * @brief 由扩展配置生成线程池的伸缩参数；
+ * @param config 扩展配置；
+ */
+ThreadPool::Scaling WebServer::PoolScaling_(const ServerConfig& config) {
+    ThreadPool::Scaling scaling;
+    scaling.minThreads = static_cast<size_t>(max(config.threadMin, 0));
+    scaling.maxThreads = static_cast<size_t>(max(config.threadMax, 0));
+    scaling.targetWaitMS = config.poolTargetWaitMS;
+    scaling.idleRetireMS = config.poolIdleMS;
+    scaling.spinUS = config.poolSpinUS;
+    return scaling;
+}
+
+/**
+ * @brief 创建数据库通道：固定线程数，排队上限即注入队列的容量，线程启动时按dbNice降低优先级；
+ * @param config 扩展配置；
+ * @return dbThreads不大于0时返回nullptr，表示不单独开通道；
+ */
+ThreadPool* WebServer::DbLane_(const ServerConfig& config) {
+    if(config.dbThreads <= 0) { return nullptr; }
+    size_t capacity = 2;
+    while(capacity < static_cast<size_t>(max(config.dbQueueLimit, 1))) { capacity <<= 1; }
+    ThreadPool::ThreadInit init = nullptr;
+    if(config.dbNice > 0) {
+        int nice = config.dbNice;
+        // Linux上nice值属于线程，who传线程号只影响这一个线程
+        init = [nice](size_t) { setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice); };
+    }
+    return new ThreadPool(config.dbThreads, capacity, init);
+}
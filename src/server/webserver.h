@@ -5,22 +5,33 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
-#include <unordered_map>
 #include <fcntl.h>      // fcntl()操作文件描述符
 #include <unistd.h>     // close()
 #include <assert.h>     // 包含断言
 #include <errno.h>
 #include <sys/socket.h> // socket bind等
 #include <netinet/in.h> // 声明了网络字节序和主机字节序之间的转换函数
+#include <netinet/tcp.h>    // TCP_DEFER_ACCEPT
 #include <arpa/inet.h>  // 包含了IP地址转换的相关函数
-
-#include "epoller.h"    // epoller管理所有事件
+#include <sys/resource.h>   // setpriority
+#include <sys/syscall.h>    // SYS_gettid
+
+#include "fdreclaimer.h"  // 关闭的描述符留到本轮事件处理完再释放
+#include "poller.h"     // IO后端(epoll或io_uring)管理所有事件
+#include "epoller.h"    // 设置套接字的忙轮询选项
+#include "subreactor.h" // 子Reactor
+#include "handover.h"   // 热升级时交接监听套接字
+#include "conntable.h"  // 以描述符为下标的连接表
+#include "serverconfig.h"   // 扩展配置
 #include "../log_system/log.h" // 日志打印
-#include "../timer/heaptimer.h"     // 定时器
+#include "../metrics/metrics.h"    // 运行计数器
+#include "../timer/timingwheel.h"   // 定时器
 #include "../sql_connection_pool/sqlconnpool.h"    // 数据库连接池
 #include "../threadpool/threadpool.h"     // 线程池
+#include "../threadpool/codel.h"    // 按排队时间丢弃请求
 #include "../sql_connection_pool/sqlconnRAII.h"    // 用户认证RAII
 #include "../http/httpconn.h"       // http连接处理
+#include "../topology/cputopology.h"    // 绑核与NUMA拓扑
 
 // WebServer是一个整体的功能块的集合，这个功能块附带的功能有：
 class WebServer {
@@ -29,37 +40,86 @@ public:
         int port, int trigMode, int timeoutMS, bool OptLinger, 
         int sqlPort, const char* sqlUser, const  char* sqlPwd, 
         const char* dbName, int connPoolNum, int threadNum,
-        bool openLog, int logLevel, int logQueSize);
+        bool openLog, int logLevel, int logQueSize,
+        const ServerConfig& config = ServerConfig());
 
     ~WebServer();   // 析构
 
     void Start();
 
 private:
+    typedef bool (WebServer::*Handler)(HttpConn*);   // 线程池任务执行的处理函数，返回true表示连接已交给其他任务
+
     bool InitSocket_();
 
+    bool BindListen_();
+
     void InitEventMode_(int trigMode);
 
     void DealListen_();
 
-    void OnProcess(HttpConn* client);
+    bool OnProcess(HttpConn* client);
     
     void AddClient_(int fd, sockaddr_in addr); 
 
-    void OnRead_(HttpConn* client);
+    bool OnRead_(HttpConn* client);
+
+    bool OnWrite_(HttpConn* client);
 
-    void OnWrite_(HttpConn* client);
+    bool OnVerify_(HttpConn* client);
+
+    bool Respond_(HttpConn* client);
 
     void DealRead_(HttpConn* client);
 
     void DealWrite_(HttpConn* client);
 
+    bool OnReadInline_(HttpConn* client);
+
+    bool OnProcessInline_(HttpConn* client);
+
+    void RunOwned_(HttpConn* client, Handler handler);
+
+    void Dispatch_(HttpConn* client, Handler handler);
+
+    Handler Admit_(Handler handler, int64_t stampUS);
+
+    bool OnShed_(HttpConn* client);
+
+    void RequestClose_(HttpConn* client);
+
+    bool SendResponse_(HttpConn* client);
+
     void SendError_(int fd, const char*info);
 
+    bool RejectByReserve_();
+
     void ExtentTime_(HttpConn* client);
 
+    void OnTimeout_(HttpConn* client);
+
     void CloseConn_(HttpConn* client);
 
+    void DispatchClient_(int fd, sockaddr_in addr);
+
+    void DealUpgrade_();
+
+    void StartDrain_();
+
+    int DrainRemainMS_() const;
+
+    int ReportMetrics_();
+
+    static std::vector<int> CpuList_(const char* list);
+
+    static int PinLoop_(const ServerConfig& config);
+
+    static ThreadPool::ThreadInit PinWorkers_(const char* list);
+
+    static ThreadPool::Scaling PoolScaling_(const ServerConfig& config);
+
+    static ThreadPool* DbLane_(const ServerConfig& config);
+
     static const int MAX_FD = 65536;    // 服务器能处理的最大连接数
 
     // 设置非阻塞模式
@@ -67,18 +127,44 @@ private:
 
     int port_;  // 端口
     bool openLinger_;   // 是否开启优雅关闭
+    bool reusePort_;    // 是否开启SO_REUSEPORT
+    int workerId_;      // 工作进程编号，-1表示单进程
     int timeoutMS_; // 毫秒MS
     bool isClose_;  // 服务器的连接状态
+    bool inlineMode_;   // 不会阻塞的请求是否在主线程内直接完成
+    int busyPollUS_;    // 单Reactor模式下主循环的忙轮询预算
+    int loopCpu_;       // 主循环绑定的CPU，-1表示未绑定；要在连接表等成员分配内存之前完成绑定
     int listenFd_;  // 监听的描述符
+    int listenBacklog_; // listen的积压队列长度
+    int acceptBudget_;  // 每次最多accept的连接数
+    int deferAcceptS_;  // TCP_DEFER_ACCEPT的秒数
+    bool acceptPending_;    // 上一次accept用完了预算，队列中可能还有连接
+    int reserveFd_;     // 预留的描述符，描述符耗尽(EMFILE)时释放它来accept并拒绝连接
+    int upgradeFd_; // 等待新进程来取监听套接字的Unix域套接字，-1表示未开启
+    const char* upgradePath_;   // upgradeFd_绑定的路径
+    int drainTimeoutMS_;    // 排空连接的最长时间
+    std::atomic<bool> isDraining_;  // 监听套接字已交出，正在排空连接
+    TimeStamp drainDeadline_;   // 排空的截止时间
+    int metricsIntervalMS_; // 计数器输出间隔
+    TimeStamp nextReport_;  // 下一次输出计数器的时间
+    std::thread::id loopThread_;    // 主循环所在的线程，只有它能操作timer_
+    FdReclaimer retired_;   // 已关闭连接的描述符，主循环在两轮事件之间释放
     char* srcDir_;  // 资源路径
     
     uint32_t listenEvent_;  // 监听事件；
     uint32_t connEvent_;    // 连接事件；
+    HttpConn::IoFunc readFn_;   // 连接的读函数，由InitEventMode_按触发模式选定
+    HttpConn::IoFunc writeFn_;  // 连接的写函数
    
-    std::unique_ptr<HeapTimer> timer_;  // 指向定时器的指针；
     std::unique_ptr<ThreadPool> threadpool_;    // 指向线程池的指针；
-    std::unique_ptr<Epoller> epoller_;  // 指向epoller事件处理器的指针；
-    std::unordered_map<int, HttpConn> users_;   // 套接字<->HTTP连接，映射的下标操作会进行value的默认构造；
+    std::unique_ptr<ThreadPool> dbpool_;    // 数据库通道，只执行查询数据库的请求，为空表示与threadpool_共用；
+    std::unique_ptr<CoDel> codel_;  // 按排队时间丢弃threadpool_中积压的请求，为空表示不丢弃；
+    size_t affinityDepth_;  // 按连接分派时所属线程队列的深度上限，0表示不按连接分派；
+    std::unique_ptr<Poller> epoller_;   // 指向IO后端(事件处理器)的指针；
+    std::unique_ptr<ConnTable> users_;  // 套接字<->HTTP连接，以描述符为下标，所有Reactor共用；
+    std::unique_ptr<TimingWheel> timer_;    // 指向定时器(时间轮)的指针；结点嵌在users_的连接中，必须声明在users_之后，先于它析构；
+    std::vector<std::unique_ptr<SubReactor>> reactors_; // 子Reactor，为空表示单Reactor模式
+    size_t nextReactor_;    // 轮询分发新连接时的下标
 };
 
 
@@ -0,0 +1,33 @@
+/*
+排队时间控制器的具体实现
+*/
+#include "codel.h"
+
+static const int64_t NO_SAMPLE = INT64_MAX;    // 区间内还没有任务出队
+
+/**
+ * @brief 构造函数；
+ * @param targetUS 目标排队时间(微秒)；
+ * @param intervalUS 判断是否持续积压的区间长度(微秒)；
+ */
+CoDel::CoDel(int64_t targetUS, int64_t intervalUS):
+    targetUS_(targetUS), intervalUS_(intervalUS), intervalEnd_(0), minDelay_(NO_SAMPLE), overloaded_(false) {}
+
+/**
+ * @brief 任务出队时调用，记录它的排队时间并决定是否丢弃；
+ * 区间结束时以区间内的最小排队时间更新过载状态：没有样本(队列空闲)或者中间空闲了超过一个区间，都不算过载；
+ * @param sojournUS 任务的排队时间；
+ * @param nowUS 当前时间；
+ * @return 应当丢弃这个任务时返回true；
+ */
+bool CoDel::Shed(int64_t sojournUS, int64_t nowUS) {
+    int64_t end = intervalEnd_.load(std::memory_order_relaxed);
+    if(nowUS >= end && intervalEnd_.compare_exchange_strong(end, nowUS + intervalUS_, std::memory_order_relaxed)) {
+        int64_t minDelay = minDelay_.exchange(NO_SAMPLE, std::memory_order_relaxed);
+        bool idleGap = nowUS - end >= intervalUS_;
+        overloaded_.store(minDelay != NO_SAMPLE && minDelay > targetUS_ && !idleGap, std::memory_order_relaxed);
+    }
+    int64_t cur = minDelay_.load(std::memory_order_relaxed);
+    while(sojournUS < cur && !minDelay_.compare_exchange_weak(cur, sojournUS, std::memory_order_relaxed)) {}
+    return overloaded_.load(std::memory_order_relaxed) && sojournUS > 2 * targetUS_;
+}
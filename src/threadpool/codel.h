@@ -0,0 +1,40 @@
+/*
+头文件介绍：
+- 按排队时间(sojourn time)判断过载并丢弃任务的控制器，思路来自CoDel：只看排队时间，不看队列长度；
+- 一个区间(interval)内排队时间的最小值都超过目标(target)，说明队列一直没有排空，是持续的积压而不是突发；
+- 处于过载时，排队超过两倍目标的任务直接丢弃(由调用者快速失败)，队列很快回落到目标附近，没排那么久的照常处理；
+- 每个出队的任务调用一次Shed，只用原子变量，多个工作线程可以同时调用；区间切换时的竞争只会让统计略有误差；
+*/
+#ifndef CODEL_H
+#define CODEL_H
+
+#include <atomic>
+#include <stdint.h>
+
+class CoDel {
+public:
+    /**
+     * @brief 构造函数；
+     * @param targetUS 目标排队时间(微秒)；
+     * @param intervalUS 判断是否持续积压的区间长度(微秒)；
+     */
+    CoDel(int64_t targetUS, int64_t intervalUS);
+
+    bool Shed(int64_t sojournUS, int64_t nowUS);
+
+    /**
+     * @brief 最近一个区间是否判定为过载；
+     */
+    bool IsOverloaded() const {
+        return overloaded_.load(std::memory_order_relaxed);
+    }
+
+private:
+    const int64_t targetUS_;
+    const int64_t intervalUS_;
+    std::atomic<int64_t> intervalEnd_;  // 当前区间的结束时间
+    std::atomic<int64_t> minDelay_;     // 当前区间内排队时间的最小值
+    std::atomic<bool> overloaded_;      // 上一个区间的结论
+};
+
+#endif //CODEL_H
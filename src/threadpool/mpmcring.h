@@ -0,0 +1,162 @@
+/*
+头文件介绍：
+- 有界的无锁多生产者多消费者环形队列(Dmitry Vyukov的bounded MPMC queue)，作为线程池的注入队列；
+- 每个槽位带一个序号，生产者与消费者各自用CAS领取下标，领到之后独占这个槽位，元素按值存放在槽位中；
+- 元素只需要能移动，入队和出队都不分配内存；
+- 队列满时TryPush返回false并保留元素，由调用者决定如何处理；
+- TryPushN一次CAS领取连续的多个槽位，用于批量提交；
+*/
+#ifndef MPMC_RING_H
+#define MPMC_RING_H
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+template<typename T>
+class MpmcRing {
+public:
+    /**
+     * @brief 构造函数；
+     * @param capacity 容量，必须是2的幂；
+     */
+    explicit MpmcRing(size_t capacity): mask_(capacity - 1), cells_(new Cell_[capacity]) {
+        assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+        for(size_t i = 0; i < capacity; i++) { cells_[i].seq.store(i, std::memory_order_relaxed); }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    ~MpmcRing() {
+        T item;
+        while(TryPop(&item)) {}     // 析构残留的元素
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    /**
+     * @brief 入队；
+     * @param item 要入队的元素，成功时被移走，失败时保持不变；
+     * @return 队列已满返回false；
+     */
+    bool TryPush(T& item) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while(true) {
+            Cell_& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if(diff == 0) {     // 槽位空闲，尝试领取
+                if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ::new(static_cast<void*>(&cell.storage)) T(std::move(item));
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(diff < 0) {   // 槽位中的元素还没被取走，队列满了
+                return false;
+            } else {    // 被其他生产者抢先了
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief 批量入队：数出从当前位置起连续空闲的槽位，一次CAS全部领取；
+     * @param items 要入队的元素数组，入队的前若干个被移走；
+     * @param n 元素个数；
+     * @return 入队的个数，队列剩余空间不够时只入队前面的部分，满了返回0；
+     */
+    size_t TryPushN(T* items, size_t n) {
+        if(n == 0) { return 0; }
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while(true) {
+            size_t k = 0;
+            for(; k < n; k++) {
+                size_t seq = cells_[(pos + k) & mask_].seq.load(std::memory_order_acquire);
+                if(seq != pos + k) { break; }
+            }
+            if(k == 0) {
+                size_t seq = cells_[pos & mask_].seq.load(std::memory_order_acquire);
+                if(static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0) { return 0; }    // 满了
+                pos = enqueuePos_.load(std::memory_order_relaxed);  // 被其他生产者抢先了
+                continue;
+            }
+            // 下标还停在pos说明这k个槽位没有别人领取，领取之后逐个放入并发布
+            if(enqueuePos_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                for(size_t i = 0; i < k; i++) {
+                    Cell_& cell = cells_[(pos + i) & mask_];
+                    ::new(static_cast<void*>(&cell.storage)) T(std::move(items[i]));
+                    cell.seq.store(pos + i + 1, std::memory_order_release);
+                }
+                return k;
+            }
+        }
+    }
+
+    /**
+     * @brief 出队；
+     * @param item 出队的元素移入这里；
+     * @return 队列为空返回false；
+     */
+    bool TryPop(T* item) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        while(true) {
+            Cell_& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if(diff == 0) {
+                if(dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    T* stored = reinterpret_cast<T*>(&cell.storage);
+                    *item = std::move(*stored);
+                    stored->~T();
+                    cell.seq.store(pos + mask_ + 1, std::memory_order_release);  // 留给下一圈的生产者
+                    return true;
+                }
+            } else if(diff < 0) {   // 队列为空
+                return false;
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief 粗略判断队列是否为空，结果可能立即过时；
+     */
+    bool Empty() const {
+        return enqueuePos_.load(std::memory_order_relaxed) == dequeuePos_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 粗略的元素个数，结果可能立即过时；
+     */
+    size_t Size() const {
+        size_t enq = enqueuePos_.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    size_t Capacity() const {
+        return mask_ + 1;
+    }
+
+private:
+    struct Cell_ {
+        std::atomic<size_t> seq;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell_[]> cells_;
+    char pad0_[64];     // 生产者与消费者的下标放在不同的缓存行
+    std::atomic<size_t> enqueuePos_;
+    char pad1_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeuePos_;
+};
+
+#endif //MPMC_RING_H
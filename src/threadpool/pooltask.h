@@ -0,0 +1,147 @@
+/*
+头文件介绍：
+- 线程池的任务类型，替代std::function<void()>；
+- 只能移动，不能拷贝，因此可以捕获unique_ptr之类的对象；
+- 可调用对象不超过INLINE_SIZE字节时直接存放在任务内部，不分配内存，整个任务正好占一个缓存行；
+- 可平凡拷贝的可调用对象(只捕获指针、整数的lambda，如(处理函数, 连接)这种最常见的任务)移动时只复制字节，也不需要析构；
+- 超过大小的可调用对象退化为在堆上分配；
+*/
+#ifndef POOL_TASK_H
+#define POOL_TASK_H
+
+#include <stddef.h>
+#include <string.h>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+class PoolTask {
+public:
+    static const size_t INLINE_SIZE = 48;   // 内联存放的可调用对象的最大字节数
+    static const size_t INLINE_ALIGN = 16;
+
+    PoolTask() noexcept : invoke_(nullptr), manage_(nullptr) {}
+
+    /**
+     * @brief 由可调用对象构造任务；
+     * @param f 可调用对象，能内联存放时不分配内存；
+     */
+    template<typename F, typename Fn = typename std::decay<F>::type,
+             typename = typename std::enable_if<!std::is_same<Fn, PoolTask>::value>::type>
+    PoolTask(F&& f): PoolTask() {  // 隐式转换，submit可以直接传入lambda
+        Init_<Fn>(std::forward<F>(f), std::integral_constant<bool, IsInline_<Fn>()>());
+    }
+
+    PoolTask(PoolTask&& other) noexcept : PoolTask() {
+        MoveFrom_(other);
+    }
+
+    PoolTask& operator=(PoolTask&& other) noexcept {
+        if(this != &other) {
+            Reset();
+            MoveFrom_(other);
+        }
+        return *this;
+    }
+
+    PoolTask(const PoolTask&) = delete;
+    PoolTask& operator=(const PoolTask&) = delete;
+
+    ~PoolTask() { Reset(); }
+
+    /**
+     * @brief 执行任务；
+     */
+    void operator()() {
+        invoke_(storage_);
+    }
+
+    /**
+     * @brief 是否持有可调用对象；
+     */
+    explicit operator bool() const {
+        return invoke_ != nullptr;
+    }
+
+    /**
+     * @brief 析构持有的可调用对象，变为空任务；
+     */
+    void Reset() {
+        if(manage_) { manage_(DESTROY, storage_, nullptr); }
+        invoke_ = nullptr;
+        manage_ = nullptr;
+    }
+
+private:
+    enum OP { MOVE, DESTROY };
+    typedef void (*Invoke)(void*);
+    typedef void (*Manage)(OP, void* dst, void* src);   // 为nullptr表示存储区可以直接按字节复制，且不需要析构
+
+    /**
+     * @brief 可调用对象能否内联存放；
+     */
+    template<typename Fn>
+    static constexpr bool IsInline_() {
+        return sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= INLINE_ALIGN
+            && std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    /**
+     * @brief 内联存放；
+     */
+    template<typename Fn, typename F>
+    void Init_(F&& f, std::true_type) {
+        ::new(static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+        invoke_ = [](void* p) { (*static_cast<Fn*>(p))(); };
+        manage_ = std::is_trivially_copyable<Fn>::value ? nullptr : &ManageInline_<Fn>;
+    }
+
+    /**
+     * @brief 存放在堆上，存储区里只保存指针；
+     */
+    template<typename Fn, typename F>
+    void Init_(F&& f, std::false_type) {
+        Fn* heap = new Fn(std::forward<F>(f));
+        memcpy(storage_, &heap, sizeof(heap));
+        invoke_ = [](void* p) { (**static_cast<Fn**>(p))(); };
+        manage_ = &ManageHeap_<Fn>;
+    }
+
+    template<typename Fn>
+    static void ManageInline_(OP op, void* dst, void* src) {
+        if(op == MOVE) {
+            ::new(dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        } else {
+            static_cast<Fn*>(dst)->~Fn();
+        }
+    }
+
+    template<typename Fn>
+    static void ManageHeap_(OP op, void* dst, void* src) {
+        if(op == MOVE) {
+            memcpy(dst, src, sizeof(Fn*));
+        } else {
+            delete *static_cast<Fn**>(dst);
+        }
+    }
+
+    /**
+     * @brief 从other移入，调用前自身必须为空，之后other为空；
+     */
+    void MoveFrom_(PoolTask& other) noexcept {
+        if(!other.invoke_) { return; }
+        if(other.manage_) { other.manage_(MOVE, storage_, other.storage_); }
+        else { memcpy(storage_, other.storage_, INLINE_SIZE); }
+        invoke_ = other.invoke_;
+        manage_ = other.manage_;
+        other.invoke_ = nullptr;
+        other.manage_ = nullptr;
+    }
+
+    alignas(INLINE_ALIGN) unsigned char storage_[INLINE_SIZE];
+    Invoke invoke_;
+    Manage manage_;
+};
+
+#endif //POOL_TASK_H
@@ -0,0 +1,501 @@
+/*
+工作窃取线程池的具体实现
+*/
+#include "threadpool.h"
+using namespace std;
+
+thread_local ThreadPool::Worker_* ThreadPool::current_ = nullptr;
+thread_local ThreadPool::Batch* ThreadPool::batch_ = nullptr;
+
+/**
+ * @brief 开始批量提交；
+ * @param pool 提交的目标线程池，为nullptr或当前线程是工作线程时不起作用；
+ */
+ThreadPool::Batch::Batch(ThreadPool* pool): pool_(current_ ? nullptr : pool), prev_(batch_), count_(0), homeCount_(0) {
+    if(pool_) { batch_ = this; }
+}
+
+/**
+ * @brief 提交攒下的任务，结束批量提交；
+ */
+ThreadPool::Batch::~Batch() {
+    if(!pool_) { return; }
+    Flush();
+    batch_ = prev_;
+}
+
+/**
+ * @brief 把攒下的任务放进注入队列，按任务数唤醒休眠的线程，再唤醒按键分派的任务的所属线程；
+ */
+void ThreadPool::Batch::Flush() {
+    if(count_ > 0) {
+        pool_->PushBatch_(tasks_, count_);
+        count_ = 0;
+    }
+    if(homeCount_ > 0) {
+        pool_->WakeHomes_(homes_, homeCount_);
+        homeCount_ = 0;
+    }
+}
+
+/**
+ * @brief 固定大小的线程池；
+ * @param threadCount 线程池中的线程数量，默认为8(8线程)
+ * @param queueCapacity 注入队列的容量，必须是2的幂；
+ * @param init 每个工作线程启动后先执行的回调，可以为空；
+ */
+ThreadPool::ThreadPool(size_t threadCount, size_t queueCapacity, ThreadInit init):
+    ThreadPool(threadCount, queueCapacity, std::move(init), Scaling()) {}
+
+/**
+ * @brief 线程池的构造函数；
+ * @param threadCount 线程池中的线程数量，默认为8(8线程)
+ * @param queueCapacity 注入队列的容量，必须是2的幂，满了之后的任务进入加锁的溢出队列；
+ * @param init 每个工作线程启动后先执行的回调，可以为空；
+ * @param scaling 伸缩与休眠参数，默认固定为threadCount个线程、不自旋；
+ */
+ThreadPool::ThreadPool(size_t threadCount, size_t queueCapacity, ThreadInit init, const Scaling& scaling):
+    init_(std::move(init)), inject_(queueCapacity), overflowCount_(0), idle_(0), spinning_(0), threads_(0), slotCount_(0),
+    blocked_(0), probeStamp_(0), probeWaitUS_(0), retire_(0), windowStartUS_(NowUS_()), minIdle_(INT_MAX),
+    isClosed_(false) {
+    assert(threadCount > 0);
+    size_t maxThreads = max(threadCount, scaling.maxThreads);
+    min_ = scaling.minThreads > 0 ? min(scaling.minThreads, threadCount) : threadCount;
+    elastic_ = min_ < maxThreads;
+    targetWaitUS_ = max(scaling.targetWaitMS, 1) * 1000;
+    idleRetireMS_ = max(scaling.idleRetireMS, 1);
+    sampleMS_ = max(scaling.sampleMS, 1);
+    cpus_ = max(static_cast<int>(thread::hardware_concurrency()), 1);
+    spinUS_ = cpus_ > 1 ? max(scaling.spinUS, 0) : 0;    // 单CPU时自旋只会占住提交者的CPU
+    // 先把所有槽位的队列建好，线程启动后马上就可能互相窃取
+    for(size_t i = 0; i < maxThreads; i++) {
+        workers_.emplace_back(new Worker_());
+        workers_[i]->pool = this;
+        workers_[i]->index = i;
+        workers_[i]->seed = static_cast<uint32_t>(i * 2654435761u + 1);
+    }
+    {
+        lock_guard<mutex> locker(mtx_);
+        Spawn_(threadCount);
+    }
+    if(elastic_) { monitor_ = thread([this] { Monitor_(); }); }
+}
+
+/**
+ * @brief 析构函数，等所有已提交的任务执行完再回收线程；
+ */
+ThreadPool::~ThreadPool() {
+    Shutdown();
+}
+
+/**
+ * @brief 关闭线程池，等所有已提交的任务执行完再回收线程，可以重复调用；
+ * 关闭之后submit抛出异常，TrySubmit返回false，两个线程池互相提交任务时可以先关闭其中一个；
+ */
+void ThreadPool::Shutdown() {
+    {
+        lock_guard<mutex> locker(mtx_);
+        isClosed_.store(true);   // 设定线程池的关闭状态
+        while(!parked_.empty()) { Unpark_(parked_.back()); }    // 唤醒所有休眠的工作线程
+    }
+    monitorCond_.notify_all();
+    if(monitor_.joinable()) { monitor_.join(); }    // 之后不会再有新线程
+    for(auto& worker : workers_) {
+        if(worker->thread.joinable()) { worker->thread.join(); }
+    }
+}
+
+/**
+ * @brief 提交任务：工作线程提交的放进自己的队列，其他线程提交的放进注入队列；有休眠的工作线程时唤醒一个；
+ * 双端队列只能存指针，工作线程内提交时分配一次；注入队列按值存放，满了才退化到加锁的溢出队列；
+ * @param task 任务；
+ */
+void ThreadPool::Push_(Task task) {
+    Worker_* self = current_;
+    if(self && self->pool == this) {
+        self->deque.Push(new Task(std::move(task)));
+    } else {
+        if(isClosed_.load(memory_order_relaxed)) { throw runtime_error("submit on stopped ThreadPool"); }
+        Batch* batch = batch_;
+        if(batch && batch->pool_ == this) {     // 先攒着，批量提交时统一唤醒
+            batch->tasks_[batch->count_++] = std::move(task);
+            if(batch->count_ == Batch::CAPACITY) { batch->Flush(); }
+            return;
+        }
+        if(!inject_.TryPush(task)) {    // 注入队列满了，退化为加锁
+            lock_guard<mutex> locker(mtx_);
+            overflow_.push_back(std::move(task));
+            overflowCount_.store(overflow_.size(), memory_order_relaxed);
+        }
+    }
+    Wake_();
+}
+
+/**
+ * @brief 有界提交，不论在哪个线程里调用都进注入队列；
+ * @param task 任务，成功时被移走；
+ * @return 注入队列满了或线程池已关闭时返回false；
+ */
+bool ThreadPool::TryPush_(Task& task) {
+    if(isClosed_.load(memory_order_relaxed) || !inject_.TryPush(task)) { return false; }
+    Wake_();
+    return true;
+}
+
+/**
+ * @brief 把一批任务放进注入队列，一次CAS领取连续的槽位，放不下的一次加锁放进溢出队列；
+ * @param tasks 任务数组，全部被移走；
+ * @param n 任务个数；
+ */
+void ThreadPool::PushBatch_(Task* tasks, size_t n) {
+    size_t pushed = inject_.TryPushN(tasks, n);
+    if(pushed < n) {
+        lock_guard<mutex> locker(mtx_);
+        for(size_t i = pushed; i < n; i++) { overflow_.push_back(std::move(tasks[i])); }
+        overflowCount_.store(overflow_.size(), memory_order_relaxed);
+    }
+    Wake_(n);
+}
+
+/**
+ * @brief 按键分派：放进所属线程的队列并唤醒它，所属线程就是当前线程时放进自己的双端队列；
+ * 所属队列已有depth个任务、已满或者所属线程已退出时，退化为Push_；
+ * @param key 键；
+ * @param depth 所属队列的深度上限；
+ * @param task 任务；
+ */
+void ThreadPool::PushHome_(size_t key, size_t depth, Task task) {
+    Worker_* home = workers_[key % min_].get();    // 核心线程不会退出，映射固定
+    if(home == current_) {
+        Push_(std::move(task));
+        return;
+    }
+    if(isClosed_.load(memory_order_relaxed)) { throw runtime_error("submit on stopped ThreadPool"); }
+    if(!home->active.load(memory_order_relaxed) || home->home.Size() >= depth || !home->home.TryPush(task)) {
+        Metrics::Instance()->Add(Metrics::POOL_SPILL);
+        Push_(std::move(task));
+        return;
+    }
+    Batch* batch = batch_;
+    if(batch && batch->pool_ == this) {     // 本轮结束时统一唤醒
+        batch->homes_[batch->homeCount_++] = home->index;
+        if(batch->homeCount_ == Batch::CAPACITY) { batch->Flush(); }
+        return;
+    }
+    WakeHomes_(&home->index, 1);
+}
+
+/**
+ * @brief 提交任务之后调用，自旋的线程接不住时唤醒休眠的线程，最多n个，一次加锁；
+ * 正在运行的线程占满了CPU时不唤醒：它们都没有计入idle_，休眠前一定能看到这个任务；
+ * 多唤醒的线程只会与它们轮流占用CPU，单CPU时每个任务都要付出一次唤醒和一次休眠；
+ * @param n 刚提交的任务数；
+ */
+void ThreadPool::Wake_(size_t n) {
+    // 与Park_中的idle_++配对：要么这里看到有线程在休眠，要么它休眠前能看到这个任务；
+    // 自旋的线程先减spinning_再进入Park_，同样被这个屏障覆盖
+    atomic_thread_fence(memory_order_seq_cst);
+    size_t spinning = static_cast<size_t>(spinning_.load(memory_order_relaxed));
+    int idle = idle_.load(memory_order_relaxed);
+    if(n <= spinning || idle <= 0) { return; }
+    // 被唤醒但还没从Park_返回的线程仍计入idle_，这里只会少算正在运行的线程，多唤醒而不会漏唤醒
+    int running = static_cast<int>(threads_.load(memory_order_relaxed)) - idle - blocked_.load(memory_order_relaxed);
+    if(running >= cpus_) { return; }
+    size_t wake = min(min(n - spinning, static_cast<size_t>(idle)), static_cast<size_t>(cpus_ - max(running, 0)));
+    lock_guard<mutex> locker(mtx_);     // 持锁通知，避免落在对方检查完、还没开始等待的间隙
+    for(size_t i = 0; i < wake && !parked_.empty(); i++) { Unpark_(parked_.back()); }
+}
+
+/**
+ * @brief 按键分派之后调用，唤醒任务的所属线程，一次加锁；
+ * 所属线程没在休眠时它休眠前会看到任务，不必唤醒；所属线程恰好退出时随便唤醒一个，由它窃取；
+ * @param homes 所属线程的槽位下标，可以重复；
+ * @param n 个数；
+ */
+void ThreadPool::WakeHomes_(const size_t* homes, size_t n) {
+    atomic_thread_fence(memory_order_seq_cst);  // 同Wake_
+    if(idle_.load(memory_order_relaxed) <= 0) { return; }
+    lock_guard<mutex> locker(mtx_);
+    for(size_t i = 0; i < n; i++) {
+        Worker_* home = workers_[homes[i]].get();
+        if(home->parked) { Unpark_(home); }
+        else if(!home->active.load(memory_order_relaxed) && !parked_.empty()) { Unpark_(parked_.back()); }
+    }
+}
+
+/**
+ * @brief 唤醒一个休眠的工作线程并把它移出parked_，调用时持有mtx_；
+ * @param worker 休眠中的工作线程；
+ */
+void ThreadPool::Unpark_(Worker_* worker) {
+    parked_.erase(find(parked_.begin(), parked_.end(), worker));
+    worker->parked = false;
+    worker->cond.notify_one();
+}
+
+/**
+ * @brief 在空闲的槽位上启动n个工作线程，调用时持有mtx_；
+ * @param n 要启动的线程数，槽位不够时只启动能启动的部分；
+ */
+void ThreadPool::Spawn_(size_t n) {
+    for(auto& worker : workers_) {
+        if(n == 0) { break; }
+        Worker_* self = worker.get();
+        if(self->active) { continue; }
+        // 槽位上退出的线程在释放mtx_之后就不再访问线程池了，这里回收它
+        if(self->thread.joinable()) { self->thread.join(); }
+        self->active.store(true, memory_order_relaxed);
+        threads_.fetch_add(1, memory_order_relaxed);
+        if(self->index + 1 > slotCount_.load(memory_order_relaxed)) {
+            slotCount_.store(self->index + 1, memory_order_release);
+        }
+        self->thread = thread([this, self] { Run_(self); });
+        n--;
+    }
+}
+
+/**
+ * @brief 工作线程的主循环；
+ * @param self 当前工作线程；
+ */
+void ThreadPool::Run_(Worker_* self) {
+    current_ = self;
+    if(init_) { init_(self->index); }
+    Task task;
+    while(Next_(self, &task)) {
+        task();     // 对各线程所获取的任务的执行不需要锁，这一步可以尽可能的并发
+        task.Reset();
+    }
+    current_ = nullptr;
+}
+
+/**
+ * @brief 取下一个任务：自己的队列、所属队列、注入队列、窃取，都没有就休眠；
+ * @param self 当前工作线程；
+ * @param task 取到的任务移入这里；
+ * @return 线程池关闭且没有剩余任务时返回false；
+ */
+bool ThreadPool::Next_(Worker_* self, Task* task) {
+    while(true) {
+        Task* local = nullptr;
+        if(++self->tick % INJECT_INTERVAL == 0 && PopInject_(task)) { return true; }
+        if(self->deque.Pop(&local)) {
+            *task = std::move(*local);
+            delete local;
+            return true;
+        }
+        if(self->home.TryPop(task)) { return true; }
+        if(PopInject_(task)) { return true; }
+        if(Steal_(self, task)) { return true; }
+        if(Spin_(self, task)) { return true; }
+        if(!Park_(self)) { return false; }
+    }
+}
+
+/**
+ * @brief 从注入队列取一个任务，注入队列空了再看溢出队列；
+ * @param task 取到的任务移入这里；
+ * @return 都为空时返回false；
+ */
+bool ThreadPool::PopInject_(Task* task) {
+    if(inject_.TryPop(task)) { return true; }
+    if(overflowCount_.load(memory_order_relaxed) == 0) { return false; }   // 大多数时候不用加锁
+    lock_guard<mutex> locker(mtx_);
+    if(overflow_.empty()) { return false; }
+    *task = std::move(overflow_.front());
+    overflow_.pop_front();
+    overflowCount_.store(overflow_.size(), memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief 从随机的一个工作线程开始，依次尝试窃取；双端队列都空了才取其他线程积压着的所属队列，尽量让按键分派的任务留在所属线程；
+ * @param self 当前工作线程；
+ * @param task 窃取到的任务移入这里；
+ * @return 没有窃取到时返回false；
+ */
+bool ThreadPool::Steal_(Worker_* self, Task* task) {
+    size_t n = slotCount_.load(memory_order_acquire);
+    if(n <= 1) { return false; }
+    self->seed ^= self->seed << 13;     // xorshift32
+    self->seed ^= self->seed >> 17;
+    self->seed ^= self->seed << 5;
+    size_t start = self->seed % n;
+    for(size_t i = 0; i < n; i++) {
+        Worker_* victim = workers_[(start + i) % n].get();
+        Task* stolen = nullptr;
+        if(victim != self && victim->deque.Steal(&stolen)) {
+            *task = std::move(*stolen);
+            delete stolen;
+            return true;
+        }
+    }
+    for(size_t i = 0; i < n; i++) {
+        Worker_* victim = workers_[(start + i) % n].get();
+        if(victim != self && HomeStealable_(victim) && victim->home.TryPop(task)) {
+            Metrics::Instance()->Add(Metrics::POOL_HOME_STEAL);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 休眠前自旋spinUS_，反复查看注入队列和其他线程的队列，短暂的空档不必经过一次休眠和唤醒；
+ * @param self 当前工作线程；
+ * @param task 取到的任务移入这里；
+ * @return 自旋期间取到任务时返回true；
+ */
+bool ThreadPool::Spin_(Worker_* self, Task* task) {
+    if(spinUS_ <= 0) { return false; }
+    spinning_.fetch_add(1, memory_order_relaxed);
+    int64_t deadline = NowUS_() + spinUS_;
+    bool got = false;
+    for(uint32_t i = 1; !isClosed_.load(memory_order_relaxed); i++) {
+        CpuRelax_();
+        if(self->home.TryPop(task) || PopInject_(task) || Steal_(self, task)) {
+            got = true;
+            break;
+        }
+        if(i % 64 == 0 && NowUS_() >= deadline) { break; }  // 不必每次都读时钟
+    }
+    spinning_.fetch_sub(1, memory_order_relaxed);
+    return got;
+}
+
+/**
+ * @brief 休眠直到有任务可做或线程池关闭；监视线程要求收缩时，没有任务可做的线程退出；
+ * @param self 当前工作线程；
+ * @return 线程池已关闭且没有剩余任务，或者被要求退出时返回false，工作线程应当退出；
+ */
+bool ThreadPool::Park_(Worker_* self) {
+    unique_lock<mutex> locker(mtx_);
+    idle_.fetch_add(1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);  // 与Wake_中的屏障配对
+    while(!isClosed_ && !HasWork_(self)) {
+        if(retire_ > 0 && threads_.load(memory_order_relaxed) <= min_) { retire_ = 0; }
+        if(retire_ > 0 && self->index >= min_) {   // 核心线程不退出，按键分派的映射依赖它们
+            idle_.fetch_sub(1, memory_order_relaxed);
+            Retire_(self);
+            return false;
+        }
+        self->parked = true;
+        parked_.push_back(self);
+        self->cond.wait(locker);
+        if(self->parked) {  // 虚假唤醒
+            parked_.erase(find(parked_.begin(), parked_.end(), self));
+            self->parked = false;
+        }
+    }
+    idle_.fetch_sub(1, memory_order_relaxed);
+    return !isClosed_ || HasWork_(self);    // 关闭后也要把剩余的任务执行完
+}
+
+/**
+ * @brief 当前工作线程退出，槽位留给之后扩容时复用，调用时持有mtx_；
+ * 自己的队列只有自己往里放，休眠前已经取空了；
+ * @param self 当前工作线程；
+ */
+void ThreadPool::Retire_(Worker_* self) {
+    retire_--;
+    self->active.store(false, memory_order_relaxed);
+    size_t left = threads_.fetch_sub(1, memory_order_relaxed) - 1;
+    Metrics::Instance()->Add(Metrics::POOL_RETIRE);
+    LOG_INFO("ThreadPool: worker %zu retired, %zu left", self->index, left);
+}
+
+/**
+ * @brief 注入队列、溢出队列、任何一个工作线程的双端队列、自己的所属队列中还有任务，或者其他线程的所属队列可以窃取，调用时持有mtx_；
+ * 与Steal_的条件一致，否则取不到任务的线程会在这里空转；
+ * @param self 当前工作线程；
+ */
+bool ThreadPool::HasWork_(const Worker_* self) const {
+    if(!inject_.Empty() || !overflow_.empty()) { return true; }
+    size_t n = slotCount_.load(memory_order_relaxed);
+    for(size_t i = 0; i < n; i++) {
+        const Worker_* worker = workers_[i].get();
+        if(!worker->deque.Empty()) { return true; }
+        if(worker == self ? !worker->home.Empty() : HomeStealable_(worker)) { return true; }
+    }
+    return false;
+}
+
+/**
+ * @brief 监视线程的主循环，每隔sampleMS_采样一次；
+ */
+void ThreadPool::Monitor_() {
+    unique_lock<mutex> locker(mtx_);
+    while(!isClosed_) {
+        monitorCond_.wait_for(locker, chrono::milliseconds(sampleMS_));
+        if(isClosed_) { break; }
+        locker.unlock();
+        Sample_();
+        locker.lock();
+    }
+}
+
+/**
+ * @brief 测量注入队列的排队时间，决定是否扩容：
+ * 没有未执行的探针时，取上一个探针测得的排队时间，并投放一个新的探针；
+ * 上一个探针还没执行，说明排队时间至少是它投放至今的时间；
+ * 排队时间超过目标、没有空闲线程且未达上限时扩容，至少一个，有线程在阻塞时按阻塞的线程数补充；
+ */
+void ThreadPool::Sample_() {
+    int64_t now = NowUS_();
+    // 收缩：整个窗口内始终有这么多线程闲着，说明它们是多余的
+    minIdle_ = min(minIdle_, idle_.load(memory_order_relaxed));
+    if(now - windowStartUS_ >= static_cast<int64_t>(idleRetireMS_) * 1000) {
+        size_t threads = threads_.load(memory_order_relaxed);
+        size_t extra = threads > min_ ? min(static_cast<size_t>(minIdle_), threads - min_) : 0;
+        if(extra > 0) {
+            lock_guard<mutex> locker(mtx_);
+            retire_ = extra;
+            // 只叫醒扩容出来的线程，核心线程醒了也不会退出
+            size_t woken = 0;
+            for(size_t i = parked_.size(); i > 0 && woken < extra; i--) {
+                if(parked_[i - 1]->index >= min_) {
+                    Unpark_(parked_[i - 1]);
+                    woken++;
+                }
+            }
+        }
+        windowStartUS_ = now;
+        minIdle_ = INT_MAX;
+    }
+
+    int64_t stamp = probeStamp_.load(memory_order_acquire);
+    int64_t waitUS = 0;
+    if(stamp == 0 && idle_.load(memory_order_relaxed) > 0 && inject_.Empty()) {
+        return;     // 有线程闲着，不用测，也不要为了探针去叫醒它
+    }
+    if(stamp != 0) {
+        waitUS = now - stamp;
+    } else {
+        waitUS = probeWaitUS_.load(memory_order_relaxed);
+        probeStamp_.store(now, memory_order_relaxed);
+        Task probe([this, now] {
+            probeWaitUS_.store(NowUS_() - now, memory_order_relaxed);
+            probeStamp_.store(0, memory_order_release);
+        });
+        if(inject_.TryPush(probe)) { Wake_(); }
+        else {  // 注入队列已满，肯定排不上
+            probeStamp_.store(0, memory_order_relaxed);
+            waitUS = targetWaitUS_ + 1;
+        }
+    }
+    if(waitUS <= targetWaitUS_ || idle_.load(memory_order_relaxed) > 0) { return; }
+    size_t threads = threads_.load(memory_order_relaxed);
+    if(threads >= workers_.size()) { return; }
+    size_t add = min(static_cast<size_t>(max(blocked_.load(memory_order_relaxed), 1)), workers_.size() - threads);
+    {
+        lock_guard<mutex> locker(mtx_);
+        if(isClosed_) { return; }
+        retire_ = 0;    // 正缺线程，取消还没执行的收缩
+        Spawn_(add);
+    }
+    windowStartUS_ = now;
+    minIdle_ = INT_MAX;
+    Metrics::Instance()->Add(Metrics::POOL_SPAWN, add);
+    LOG_INFO("ThreadPool: queue wait %lldus, %d blocked, +%zu workers, %zu total",
+             (long long)waitUS, BlockedCount(), add, ThreadCount());
+}
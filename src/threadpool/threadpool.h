@@ -1,94 +1,287 @@
 /*
-- 这是一个基于源线程池修改的新的线程池，意在提升线程池的并发能力；
-- 主要的核心优化点在于将新建立的线程提交进一个vector数组；
-- 此外调整一些变量的设计；
-*/ 
+- 工作窃取线程池，替代原来一个队列、一把锁、一个条件变量的实现，对外的接口(构造、submit、析构时执行完剩余任务)保持一致；
+- 每个工作线程有自己的无锁双端队列，其他线程提交的任务进无锁的注入队列，自己和注入队列都空了就窃取其他线程的任务，全都没有才休眠；
+- 另有有界提交(TrySubmit)、批量提交(Batch)、按键分派(SubmitTo)与伸缩(Scaling)，见各自的注释；
+*/
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
 #include <mutex>    // 用于互斥
 #include <condition_variable>   // 用于同步
-#include <queue>    // 普通队列
+#include <deque>    // 注入队列
 #include <vector>   // 存线程
 #include <thread>   // 调线程
+#include <atomic>
+#include <memory>
+#include <stdexcept>
 #include <cassert>  // 断言关键字
+#include <chrono>
+#include <algorithm>     // min/max
+#include <climits>       // INT_MAX
 #include <functional>   // 包含了一系列函数对象与函数模板
+#include "workstealdeque.h"
+#include "mpmcring.h"
+#include "pooltask.h"
+#include "../metrics/metrics.h"   // 扩缩容计数
+
 class ThreadPool {
 public:
+    typedef PoolTask Task;     // 任务类型，不接受参数，返回void，只能移动；捕获不超过48字节时不分配内存
+    typedef std::function<void(size_t)> ThreadInit;     // 工作线程启动后、取任务前执行，参数为线程编号(用于绑核)
+
+    static const size_t QUEUE_CAPACITY = 4096;  // 注入队列的默认容量
+    static const size_t HOME_CAPACITY = 64;     // 每个工作线程所属队列的容量
+
     /**
-     * @brief 线程池的构造函数，定义为显式构造；
-     * @param threadCount 线程池中的线程数量，默认为8(8线程)
+     * @brief 伸缩与休眠参数，默认不伸缩、不自旋；
+     * 监视线程定期投放带时间戳的探针任务测量排队时间，超过目标且没有空闲线程时扩容，正在阻塞的线程越多一次补充得越多；
+     * 一整个空闲窗口内始终休眠着k个线程，就让k个扩容出来的线程退出；不按单个线程的休眠超时判断，
+     * 因为唤醒是轮流的，低负载时每个线程都会被偶尔叫醒而永远不会超时；
      */
-    explicit ThreadPool(size_t threadCount = 8): isClosed(false) {
-            assert(threadCount > 0);
-            // 下面这个for循环会创建8个不断工作的线程
-            for(size_t i = 0; i < threadCount; i++) {
-                multi_thread.emplace_back(
-                    [this]() {  // this传入这个类的地址，从而lambda可以访问该类所有成员(包括私有，因为lambda对象属于类的一部分)
-                        while (true) {
-                            std::function<void()> task;
-
-                            // 下面这个环节之所以要加锁，是因为要处理任务队列这一共享资源
-                            // 不要误判为线程与线程之间的同步哈，否则就失去了意义
-                            {
-                                std::unique_lock<std::mutex> lock(mtx);
-                                // 同步等待，直到线程池关闭或者任务队列非空了
-                                cond_cv.wait(lock, [this] () {return isClosed || !tasks.empty();});
-                                if (isClosed && tasks.empty())  return; // 可以结束lambda表达式了
-                                task = std::move(tasks.front());
-                                tasks.pop();
-                            }
-
-                            // 对各线程所获取的任务的执行不需要锁，这一步可以尽可能的并发
-                            task();
-                        }
-                    }
-                );
-            }
-    }
+    struct Scaling {
+        size_t minThreads = 0;  // 空闲线程退出后至少保留的线程数，0表示与初始线程数相同
+        size_t maxThreads = 0;  // 扩容的上限，不大于初始线程数时不扩容
+        int targetWaitMS = 5;   // 任务排队超过这么久就扩容
+        int idleRetireMS = 30000;   // 线程空闲超过这么久就退出
+        int sampleMS = 20;      // 测量排队时间的间隔
+        int spinUS = 0;         // 没有任务时先自旋这么久再休眠，0表示直接休眠
+    };
+
+    /**
+     * @brief 工作线程即将长时间阻塞(如查询数据库)时在栈上构造，离开作用域时析构；
+     * 线程池据此知道可运行的线程变少了，扩容时按阻塞的线程数补充；非工作线程中构造不起作用；
+     */
+    class BlockingScope {
+    public:
+        BlockingScope(): pool_(current_ ? current_->pool : nullptr) {
+            if(pool_) { pool_->blocked_.fetch_add(1, std::memory_order_relaxed); }
+        }
+
+        ~BlockingScope() {
+            if(pool_) { pool_->blocked_.fetch_sub(1, std::memory_order_relaxed); }
+        }
+
+        BlockingScope(const BlockingScope&) = delete;
+        BlockingScope& operator=(const BlockingScope&) = delete;
+
+    private:
+        ThreadPool* pool_;
+    };
+
+    /**
+     * @brief 批量提交，在提交任务的线程(事件循环)的栈上构造；存在期间本线程向这个线程池submit的任务先攒在这里，
+     * 攒满或析构时一次CAS放进注入队列，再按任务数唤醒休眠的线程，事件循环一轮只加一次锁；工作线程中构造不起作用；
+     */
+    class Batch {
+    public:
+        explicit Batch(ThreadPool* pool);
+
+        ~Batch();
+
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+        void Flush();
+
+    private:
+        friend class ThreadPool;
+        static const size_t CAPACITY = 64;  // 攒满这么多个就先提交一次
+
+        ThreadPool* pool_;  // 为nullptr表示不起作用
+        Batch* prev_;       // 外层的批量提交，析构时恢复
+        size_t count_;
+        size_t homeCount_;  // 按键分派、等待唤醒所属线程的任务数
+        Task tasks_[CAPACITY];
+        size_t homes_[CAPACITY];    // 这些任务所属线程的槽位下标
+    };
+
+    explicit ThreadPool(size_t threadCount = 8, size_t queueCapacity = QUEUE_CAPACITY, ThreadInit init = nullptr);
 
-    // 下面将不需要的默认构造函数(拷贝，移动，拷贝赋值，移动赋值等)都设置为delete的，节省资源
-    // 保留默认构造函数，因为上面定义的构造函数有一个默认值，这个默认的构造会用8个线程参数进行构造处理
-    ThreadPool() = default;
+    ThreadPool(size_t threadCount, size_t queueCapacity, ThreadInit init, const Scaling& scaling);
+
+    // 线程池不可拷贝、不可移动
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool(ThreadPool&&) = delete;
 
     ThreadPool& operator = (const ThreadPool&) = delete;
     ThreadPool& operator = (ThreadPool&&) = delete;
 
-    
-    ~ThreadPool() {
-        {
-            std::unique_lock<std::mutex> lock(mtx);
-            isClosed = true;    // 设定线程池的关闭状态
-        }
-        cond_cv.notify_all();   // 唤醒所有被阻塞的消费者线程
-        for (auto& threads : multi_thread)    // vector中的每个线程属于自己的任务需要完成
-            threads.join(); // threads不能定义为const的，因为join之后threads的状态要被改变了
-    }
+    ~ThreadPool();
 
     /**
      * @brief 这是一个提交任务进任务队列的函数，提交过程中会对线程池的状态进行检查；
+     * @param f f是一个函数对象，直接构造成任务，不经过std::bind；
+     */
+    template<typename F>
+    void submit(F&& f) {
+        Push_(Task(std::forward<F>(f)));
+    }
+
+    /**
+     * @brief 带参数的提交；
      * @param f f是一个函数对象；
-     * @param args args是函数的参数，由于是可变参，当然也可以为空；
+     * @param args args是函数的参数；
      */
-    template<typename F,typename... Args>
-    void submit(F&& f,Args&&... args) {  // 传右值以保证完美转发
-        {
-            std::unique_lock<std::mutex> lock(mtx);
-            if(isClosed) throw std::runtime_error("submit on stopped ThreadPool");
-            tasks.emplace(std::bind(std::forward<F>(f),std::forward<Args>(args)...));   // 给f绑定了参数
-        }
-        cond_cv.notify_one();
+    template<typename F, typename Arg, typename... Args>
+    void submit(F&& f, Arg&& arg, Args&&... args) {  // 传右值以保证完美转发
+        Push_(Task(std::bind(std::forward<F>(f), std::forward<Arg>(arg), std::forward<Args>(args)...)));   // 给f绑定了参数
     }
 
+    /**
+     * @brief 有界提交：只放进注入队列，不进溢出队列，注入队列的容量就是排队任务数的上限，用来实现有排队上限的执行通道(如数据库通道)；
+     * @param f f是一个函数对象；
+     * @return 队列满了或线程池已关闭时返回false，任务不会执行，由调用者降级处理；
+     */
+    template<typename F>
+    bool TrySubmit(F&& f) {
+        Task task(std::forward<F>(f));
+        return TryPush_(task);
+    }
+
+    /**
+     * @brief 按键分派：同一个键的任务总是交给同一个工作线程(所属线程)执行，只唤醒这个线程，连接的缓冲区等状态留在同一个CPU的缓存里；
+     * 所属线程只从前min_个槽位(收缩时不退出的核心线程)中按键取模选出，扩缩容不会改变键到线程的映射；
+     * 所属线程的队列太深、所属线程已退出时退化为submit；
+     * @param key 键，如连接的描述符；
+     * @param depth 所属线程的队列已有这么多任务时改放进注入队列；
+     * @param f f是一个函数对象；
+     */
+    template<typename F>
+    void SubmitTo(size_t key, size_t depth, F&& f) {
+        PushHome_(key, depth, Task(std::forward<F>(f)));
+    }
+
+    void Shutdown();
+
+    /**
+     * @brief 当前的工作线程数量；
+     */
+    size_t ThreadCount() const {
+        return threads_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 正在阻塞的工作线程数量；
+     */
+    int BlockedCount() const {
+        return blocked_.load(std::memory_order_relaxed);
+    }
+
+    size_t MinThreads() const { return min_; }
+
+    size_t MaxThreads() const { return workers_.size(); }
+
+    size_t QueueCapacity() const { return inject_.Capacity(); }
+
 private:
-    std::mutex mtx;     // 互斥锁
-    std::condition_variable cond_cv;   // 面向消费者线程的用于同步和通信的条件变量
-    bool isClosed;      // 表明池子开启与否的开关
-    std::queue<std::function<void()>> tasks;    // 一个任务队列，任务队列的类型是函数对象，该函数不接受参数，返回void
-    std::vector<std::thread> multi_thread;
+    /**
+     * @brief 一个工作线程及其任务队列；
+     */
+    struct Worker_ {
+        Worker_(): home(HOME_CAPACITY) {}
+
+        ThreadPool* pool;
+        size_t index;       // 线程编号(槽位下标)
+        std::atomic<bool> active{false};    // 槽位上是否有运行中的线程，持有mtx_时修改，按键分派时不加锁读
+        bool parked = false;    // 是否在parked_中，持有mtx_时读写
+        WorkStealDeque<Task*> deque;    // 自己的任务队列，其他工作线程可以从顶部窃取；只能存指针，任务放在堆上
+        MpmcRing<Task> home;    // 所属队列，按键分派给这个线程的任务，其他线程没事可做时也能取走
+        std::condition_variable cond;   // 在这里休眠
+        std::thread thread;
+        uint32_t seed;      // 挑选窃取对象的随机数种子
+        uint32_t tick = 0;  // 已经取过的任务数，用于定期检查注入队列
+    };
+
+    void Push_(Task task);
+
+    bool TryPush_(Task& task);
+
+    void PushBatch_(Task* tasks, size_t n);
+
+    void PushHome_(size_t key, size_t depth, Task task);
+
+    bool Spin_(Worker_* self, Task* task);
+
+    void Run_(Worker_* self);
+
+    bool Next_(Worker_* self, Task* task);
+
+    bool PopInject_(Task* task);
+
+    bool Steal_(Worker_* self, Task* task);
+
+    bool Park_(Worker_* self);
+
+    bool HasWork_(const Worker_* self) const;
+
+    /**
+     * @brief 其他线程的所属队列能否窃取：积压了至少两个任务，或者所属线程已退出；
+     * 只有一个任务时留给刚被唤醒的所属线程，否则在它醒来之前就被正在运行的线程取走了；
+     */
+    bool HomeStealable_(const Worker_* victim) const {
+        return victim->home.Size() >= 2 || (!victim->home.Empty() && !victim->active.load(std::memory_order_relaxed));
+    }
+
+    void Wake_(size_t n = 1);
+
+    void WakeHomes_(const size_t* homes, size_t n);
+
+    void Unpark_(Worker_* worker);
+
+    void Retire_(Worker_* self);
+
+    void Spawn_(size_t n);
+
+    void Monitor_();
+
+    void Sample_();
+
+    static void CpuRelax_() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    static int64_t NowUS_() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static const uint32_t INJECT_INTERVAL = 61;     // 每取这么多个任务先看一眼注入队列
+
+    std::vector<std::unique_ptr<Worker_>> workers_;     // 按最大线程数预先建好的槽位，窃取者遍历的数组不会变化，退出的线程留下空队列
+    ThreadInit init_;   // 工作线程的启动回调
+    size_t min_;        // 最少线程数，前min_个槽位上的线程(核心线程)一直运行
+    bool elastic_;      // 是否伸缩
+    int targetWaitUS_;  // 扩容的排队时间阈值
+    int idleRetireMS_;  // 空闲线程退出的时间
+    int sampleMS_;      // 采样间隔
+    int spinUS_;        // 休眠前自旋的时间
+    int cpus_;          // CPU数，正在运行的线程占满了CPU时不再唤醒休眠的线程
+    MpmcRing<Task> inject_;     // 注入队列，非工作线程提交的任务
+    std::mutex mtx_;    // 保护溢出队列，工作线程也在这把锁上休眠
+    std::vector<Worker_*> parked_;  // 休眠中的工作线程(栈，后休眠的先醒)，各自在自己的条件变量上等待，持有mtx_时读写
+    std::condition_variable monitorCond_;   // 监视线程在这里等待下一次采样
+    std::thread monitor_;   // 监视线程，只在伸缩时创建
+    std::deque<Task> overflow_;     // 注入队列满了之后提交的任务
+    std::atomic<size_t> overflowCount_;     // 溢出队列的长度，不加锁判断是否为空
+    std::atomic<int> idle_;     // 正在休眠(或准备休眠)的工作线程数，为0时提交任务不需要唤醒
+    std::atomic<int> spinning_; // 正在自旋等任务的工作线程数，它们能接住的任务不需要唤醒
+    std::atomic<size_t> threads_;   // 运行中的工作线程数
+    std::atomic<size_t> slotCount_; // 用过的槽位数，窃取时只需遍历这么多
+    std::atomic<int> blocked_;  // 处于BlockingScope中的工作线程数
+    std::atomic<int64_t> probeStamp_;   // 还没执行的探针的投放时间(微秒)，0表示没有
+    std::atomic<int64_t> probeWaitUS_;  // 最近一个探针测得的排队时间
+    size_t retire_;     // 还需要退出的线程数，持有mtx_时读写
+    int64_t windowStartUS_; // 当前空闲窗口的起点，只由监视线程访问
+    int minIdle_;       // 当前窗口内各采样点休眠线程数的最小值，只由监视线程访问
+    std::atomic<bool> isClosed_;    // 表明池子开启与否的开关，提交到注入队列时不加锁检查
+
+    static thread_local Worker_* current_;  // 当前线程对应的工作线程，非工作线程为nullptr
+    static thread_local Batch* batch_;  // 当前线程正在进行的批量提交
 };
 
 
-#endif //THREADPOOL_H
\ No newline at end of file
+#endif //THREADPOOL_H
@@ -0,0 +1,137 @@
+/*
+头文件介绍：
+- 工作窃取用的无锁双端队列(Chase-Lev)，每个工作线程拥有一个；
+- 只有所有者线程可以Push/Pop，在底部操作，后进先出，刚提交的任务数据还在缓存中；
+- 其他线程通过Steal从顶部取走最早的任务，多个窃取者之间以及窃取者与所有者之间以CAS竞争最后一个元素；
+- 内存序按照Lê等人《Correct and Efficient Work-Stealing for Weak Memory Models》(PPoPP'13)中的C11版本；
+- 元素类型T需要能放进std::atomic(这里存放任务指针)，环形数组满了自动扩容，旧数组留到析构时释放，窃取者可能还在读；
+*/
+#ifndef WORK_STEAL_DEQUE_H
+#define WORK_STEAL_DEQUE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <assert.h>
+
+template<typename T>
+class WorkStealDeque {
+public:
+    /**
+     * @brief 构造函数；
+     * @param capacity 初始容量，必须是2的幂；
+     */
+    explicit WorkStealDeque(int64_t capacity = 256): top_(0), bottom_(0) {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+        garbage_.emplace_back(new Array_(capacity));
+        array_.store(garbage_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealDeque(const WorkStealDeque&) = delete;
+    WorkStealDeque& operator=(const WorkStealDeque&) = delete;
+
+    /**
+     * @brief 所有者在底部压入元素；
+     */
+    void Push(T item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array_* a = array_.load(std::memory_order_relaxed);
+        if(b - t > a->capacity - 1) { a = Grow_(a, b, t); }
+        a->Put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 所有者从底部弹出元素；
+     * @return 队列为空(或最后一个元素被窃取者抢走)时返回false；
+     */
+    bool Pop(T* item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array_* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if(t > b) {     // 已经空了
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        *item = a->Get(b);
+        if(t == b) {    // 最后一个元素，与窃取者竞争
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 其他线程从顶部窃取元素；
+     * @return 队列为空或竞争失败时返回false，调用者可以换一个队列再试；
+     */
+    bool Steal(T* item) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if(t >= b) { return false; }
+        Array_* a = array_.load(std::memory_order_acquire);
+        T x = a->Get(t);
+        if(!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        *item = x;
+        return true;
+    }
+
+    /**
+     * @brief 粗略判断队列是否为空，其他线程调用时结果可能立即过时；
+     */
+    bool Empty() const {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 粗略的元素个数；
+     */
+    int64_t Size() const {
+        int64_t n = bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_relaxed);
+        return n > 0 ? n : 0;
+    }
+
+private:
+    /**
+     * @brief 环形数组，下标对容量取模；
+     */
+    struct Array_ {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Array_(int64_t cap): capacity(cap), slots(new std::atomic<T>[cap]) {}
+
+        // 论文中是relaxed加独立的屏障，这里改用release/acquire，x86上没有额外开销，ThreadSanitizer也能识别
+        T Get(int64_t i) const { return slots[i & (capacity - 1)].load(std::memory_order_acquire); }
+
+        void Put(int64_t i, T x) { slots[i & (capacity - 1)].store(x, std::memory_order_release); }
+    };
+
+    /**
+     * @brief 容量翻倍，只由所有者调用；
+     */
+    Array_* Grow_(Array_* a, int64_t b, int64_t t) {
+        Array_* bigger = new Array_(a->capacity * 2);
+        for(int64_t i = t; i < b; i++) { bigger->Put(i, a->Get(i)); }
+        garbage_.emplace_back(bigger);
+        array_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    std::atomic<int64_t> top_;      // 窃取者修改
+    char pad_[64 - sizeof(std::atomic<int64_t>)];   // 让top_与bottom_落在不同的缓存行
+    std::atomic<int64_t> bottom_;   // 只有所有者修改
+    std::atomic<Array_*> array_;
+    std::vector<std::unique_ptr<Array_>> garbage_;  // 所有用过的数组，析构时统一释放
+};
+
+#endif //WORK_STEAL_DEQUE_H
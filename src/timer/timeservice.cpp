@@ -0,0 +1,67 @@
+/*
+时间服务的具体实现
+*/
+#include "timeservice.h"
+#include <string.h>
+
+std::atomic<int64_t> TimeService::nowUS_(
+    std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count());
+thread_local bool TimeService::isLoop_ = false;
+TimeService::Slot_ TimeService::slots_[SLOT_NUM];
+std::mutex TimeService::mtx_;
+
+/**
+ * @brief 事件循环每轮调用一次，读取时钟并发布；多个循环同时调用时只会往前推进；
+ */
+void TimeService::Update() {
+    Advance(Clock::now());
+}
+
+/**
+ * @brief 把缓存的时间推进到指定时刻，当前线程之后按事件循环读取缓存的时间；只会往前推进；
+ * 服务器中只经由Update调用，单元测试与基准测试用它驱动时间轮，不必真的等待；
+ * @param stamp 新的时刻；
+ */
+void TimeService::Advance(TimeStamp stamp) {
+    int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(stamp.time_since_epoch()).count();
+    int64_t prev = nowUS_.load(std::memory_order_relaxed);
+    while(now > prev && !nowUS_.compare_exchange_weak(prev, now, std::memory_order_relaxed)) {}
+    isLoop_ = true;
+}
+
+/**
+ * @brief 当前时间：事件循环线程返回缓存的时间，其他线程读取时钟；
+ */
+TimeStamp TimeService::Now() {
+    if(!isLoop_) { return Clock::now(); }
+    return TimeStamp(std::chrono::duration_cast<Clock::duration>(
+        std::chrono::microseconds(nowUS_.load(std::memory_order_relaxed))));
+}
+
+/**
+ * @brief 取得某一秒格式化后的字符串，这一秒第一次被用到时才格式化；
+ * @param sec 自纪元起的秒数；
+ * @param text 结果；
+ */
+void TimeService::Format(time_t sec, Text* text) {
+    Slot_& slot = slots_[sec % SLOT_NUM];
+    if(slot.sec.load(std::memory_order_acquire) == sec) {
+        memcpy(text, &slot.text, sizeof(Text));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.sec.load(std::memory_order_relaxed) == sec) { return; }  // 复制期间没有被改写
+    }
+    struct tm local, gmt;
+    localtime_r(&sec, &local);
+    gmtime_r(&sec, &gmt);
+    strftime(text->log, sizeof(text->log), "%Y-%m-%d %H:%M:%S", &local);
+    strftime(text->http, sizeof(text->http), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+    text->mday = local.tm_mday;
+
+    std::unique_lock<std::mutex> locker(mtx_, std::try_to_lock);
+    if(!locker.owns_lock()) { return; }     // 别的线程正在发布，这次的结果只给自己用
+    if(slot.sec.load(std::memory_order_relaxed) >= sec) { return; }     // 不用旧的一秒覆盖新的
+    slot.sec.store(-1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.text, text, sizeof(Text));
+    slot.sec.store(sec, std::memory_order_release);
+}
@@ -0,0 +1,90 @@
+/*
+头文件介绍：
+- 缓存的时间服务，定时器、日志、HTTP响应的Date头部共用；
+- 事件循环每轮epoll_wait返回后调用一次Update读取时钟，循环线程内的其他地方直接使用缓存的时间；
+- 不是事件循环的线程(线程池、prefork主进程)没有人替它们更新，取时间时仍然读取时钟，保证不会拿到过时的时间；
+- 日志前缀与Date头部的字符串每秒只格式化一次，同一秒内的调用者直接复制结果，不再调用localtime与snprintf；
+*/
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+
+/**
+ * @brief 定义了一个时钟类型，使用墙上时间，日志与Date头部可以直接由它换算；
+ */
+typedef std::chrono::system_clock Clock;
+
+/**
+ * @brief 定义了一个毫秒级别的时间单位；
+ */
+typedef std::chrono::milliseconds MS;
+
+/**
+ * @brief 一个简单的别名定义；
+ */
+typedef Clock::time_point TimeStamp;    // 给时间点定义一个别名
+
+class TimeService {
+public:
+    /**
+     * @brief 某一秒格式化后的字符串；
+     */
+    struct Text {
+        char log[20];   // 日志前缀，本地时间"2024-01-02 15:04:05"
+        char http[30];  // Date头部，格林尼治时间"Tue, 02 Jan 2024 07:04:05 GMT"
+        int mday;       // 本地时间的日期，日志按天切分文件时使用
+    };
+
+    static void Update();
+
+    static void Advance(TimeStamp stamp);
+
+    static TimeStamp Now();
+
+    /**
+     * @brief 当前时间的微秒数(自纪元起)；
+     */
+    static int64_t NowUS() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief 当前时间的毫秒数(自纪元起)；
+     */
+    static int64_t NowMS() {
+        return std::chrono::duration_cast<MS>(Now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief 单调时钟的微秒数，不受墙上时间调整的影响，用于测量时间间隔(如排队时间)；
+     */
+    static int64_t SteadyUS() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void Format(time_t sec, Text* text);
+
+private:
+    /**
+     * @brief 一秒的格式化结果，按秒数轮流使用；sec为-1表示正在写入；
+     */
+    struct Slot_ {
+        std::atomic<int64_t> sec{-1};
+        Text text;
+    };
+
+    static const int SLOT_NUM = 4;  // 读者复制到一半被抢占的时间超过SLOT_NUM秒才会读到被改写的结果，此时会重新读取
+
+    static std::atomic<int64_t> nowUS_;     // 最近一次Update读到的时间(微秒)，多个事件循环取最大值
+    static thread_local bool isLoop_;       // 当前线程是否为事件循环(调用过Update)
+    static Slot_ slots_[SLOT_NUM];
+    static std::mutex mtx_;     // 格式化新的一秒时加锁，每秒只发生一次
+};
+
+#endif //TIME_SERVICE_H
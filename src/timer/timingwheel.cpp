@@ -0,0 +1,230 @@
+/*
+时间轮的具体实现，结构与Linux内核早期的定时器轮一致：
+- 结点按距离当前tick的远近放入不同的层，第0层的槽位与到期tick一一对应；
+- 第0层每转完一圈(当前tick低8位为0)，就把上一层对应槽中的结点重新放置，它们会落入更低的层；
+ */
+#include "timingwheel.h"
+
+/**
+ * @brief 构造函数，初始化所有槽的链表头；
+ * @param tickMS tick的粒度(毫秒)，超时时间会向上取整到它的整数倍；
+ * @param cb 结点到期时的回调函数；
+ */
+TimingWheel::TimingWheel(int tickMS, const ExpireCallBack& cb):
+            current_(0), start_(TimeService::Now()), tickMS_(tickMS > 0 ? tickMS : 1), count_(0), cb_(cb) {
+    for(auto& head : slots_) { head.prev = head.next = &head; }
+    for(auto& word : rootBits_) { word = 0; }
+}
+
+/**
+ * @brief 析构函数，把仍在时间轮中的结点摘下，结点所在的对象可能比时间轮活得更久；
+ */
+TimingWheel::~TimingWheel() {
+    for(auto& head : slots_) {
+        TimerNode* node = head.next;
+        while(node != &head) {
+            TimerNode* next = node->next;
+            node->prev = node->next = nullptr;
+            node = next;
+        }
+    }
+}
+
+/**
+ * @brief 添加结点，结点已经在时间轮中时重新设定它的超时时间；
+ * @param node 定时器结点；
+ * @param timeout 超时时间(毫秒)；
+ */
+void TimingWheel::add(TimerNode* node, int timeout) {
+    assert(node);
+    int64_t elapsed = std::chrono::duration_cast<MS>(TimeService::Now() - start_).count();
+    uint64_t expire = (elapsed + (timeout > 0 ? timeout : 0) + tickMS_ - 1) / tickMS_;
+    if(node->IsLinked()) {
+        if(node->expire == expire) { return; }  // 同一个tick内反复延长，不需要移动
+        Unlink_(node);
+    } else {
+        count_++;
+    }
+    node->expire = expire;
+    Link_(node);
+}
+
+/**
+ * @brief 取消结点，结点不在时间轮中时什么也不做；
+ * @param node 定时器结点；
+ */
+void TimingWheel::cancel(TimerNode* node) {
+    assert(node);
+    if(!node->IsLinked()) { return; }
+    Unlink_(node);
+    count_--;
+}
+
+/**
+ * @brief 把所有结点的超时时间缩短到不晚于timeout毫秒之后，用于热升级时排空连接；
+ * @param timeout 新的超时上限；
+ */
+void TimingWheel::shrink(int timeout) {
+    int64_t elapsed = std::chrono::duration_cast<MS>(TimeService::Now() - start_).count();
+    uint64_t limit = (elapsed + timeout + tickMS_ - 1) / tickMS_;
+    TimerNode moved;
+    moved.prev = moved.next = &moved;
+    for(auto& head : slots_) {
+        TimerNode* node = head.next;
+        while(node != &head) {
+            TimerNode* next = node->next;
+            if(node->expire > limit) {
+                Unlink_(node);
+                PushBack_(&moved, node);
+            }
+            node = next;
+        }
+    }
+    while(moved.next != &moved) {
+        TimerNode* node = moved.next;
+        Unlink_(node);
+        node->expire = limit;
+        Link_(node);
+    }
+}
+
+/**
+ * @brief 处理所有已经到期的tick，执行到期结点的回调；
+ */
+void TimingWheel::tick() {
+    uint64_t now = NowTick_();
+    while(current_ <= now) {
+        if(count_ == 0) {   // 时间轮是空的，直接跳到当前时间
+            current_ = now + 1;
+            break;
+        }
+        int idx = current_ & (ROOT_SIZE - 1);
+        if(idx == 0) {  // 第0层转完一圈，逐层下放
+            for(int level = 0; level < LEVELS; level++) {
+                int j = (current_ >> (ROOT_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+                Cascade_(level, j);
+                if(j != 0) { break; }
+            }
+        }
+        TimerNode expired;
+        expired.prev = expired.next = &expired;
+        Splice_(&slots_[idx], &expired);
+        rootBits_[idx >> 6] &= ~(1ull << (idx & 63));
+        current_++;     // 回调中新添加的结点不会落入正在处理的槽
+        while(expired.next != &expired) {   // 回调可能取消同一批中的其他结点，因此每次取链表头
+            TimerNode* node = expired.next;
+            Unlink_(node);
+            count_--;
+            cb_(node);
+        }
+    }
+}
+
+/**
+ * @brief 处理到期结点，并计算距离下一次需要处理的时间；
+ * @return 毫秒数，时间轮为空时返回-1；
+ */
+int TimingWheel::GetNextTick() {
+    tick();
+    if(count_ == 0) { return -1; }
+    uint64_t target = current_ + NextRoot_();
+    int64_t elapsed = std::chrono::duration_cast<MS>(TimeService::Now() - start_).count();
+    int64_t res = static_cast<int64_t>(target) * tickMS_ - elapsed;
+    return res > 0 ? static_cast<int>(res) : 0;
+}
+
+/**
+ * @brief 按到期tick把结点挂到对应的槽上；
+ */
+void TimingWheel::Link_(TimerNode* node) {
+    if(node->expire < current_) { node->expire = current_; }
+    if(node->expire - current_ >= MAX_TICKS) { node->expire = current_ + MAX_TICKS - 1; }
+    uint64_t delta = node->expire - current_;
+    TimerNode* head;
+    if(delta < ROOT_SIZE) {
+        int idx = node->expire & (ROOT_SIZE - 1);
+        rootBits_[idx >> 6] |= 1ull << (idx & 63);
+        head = &slots_[idx];
+    } else {
+        int level = 0;
+        while(delta >= (1ull << (ROOT_BITS + (level + 1) * LEVEL_BITS))) { level++; }
+        int idx = (node->expire >> (ROOT_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+        head = &slots_[ROOT_SIZE + level * LEVEL_SIZE + idx];
+    }
+    PushBack_(head, node);
+}
+
+/**
+ * @brief 把上层某个槽中的结点重新放置，它们会落入更低的层；
+ * @param level 第几层(0表示第0层之上的第一层)；
+ * @param idx 槽的下标；
+ */
+void TimingWheel::Cascade_(int level, int idx) {
+    TimerNode list;
+    list.prev = list.next = &list;
+    Splice_(&slots_[ROOT_SIZE + level * LEVEL_SIZE + idx], &list);
+    while(list.next != &list) {
+        TimerNode* node = list.next;
+        Unlink_(node);
+        Link_(node);
+    }
+}
+
+/**
+ * @brief 借助占用位图找出第0层中下一个非空的槽，不越过下一次下放的位置；
+ * @return 距离current_的tick数；
+ */
+int TimingWheel::NextRoot_() {
+    int idx = current_ & (ROOT_SIZE - 1);
+    if(idx == 0) { return 0; }  // 到了下放的位置，需要先处理上层
+    for(int k = idx; k < ROOT_SIZE; ) {
+        uint64_t word = rootBits_[k >> 6] >> (k & 63);
+        if(!word) {
+            k = (k | 63) + 1;
+            continue;
+        }
+        k += __builtin_ctzll(word);
+        if(slots_[k].next != &slots_[k]) { return k - idx; }
+        rootBits_[k >> 6] &= ~(1ull << (k & 63));  // 槽中的结点都被取消了
+        k++;
+    }
+    return ROOT_SIZE - idx;
+}
+
+/**
+ * @brief 当前时间对应的tick；
+ */
+uint64_t TimingWheel::NowTick_() const {
+    return std::chrono::duration_cast<MS>(TimeService::Now() - start_).count() / tickMS_;
+}
+
+/**
+ * @brief 把结点从所在的链表中摘下；
+ */
+void TimingWheel::Unlink_(TimerNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+}
+
+/**
+ * @brief 把结点挂到链表尾部；
+ */
+void TimingWheel::PushBack_(TimerNode* head, TimerNode* node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+/**
+ * @brief 把from链表中的所有结点整体移动到空链表to中；
+ */
+void TimingWheel::Splice_(TimerNode* from, TimerNode* to) {
+    if(from->next == from) { return; }
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    from->prev = from->next = from;
+}
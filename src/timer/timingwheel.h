@@ -0,0 +1,89 @@
+/*
+介绍：
+- 分层时间轮定时器，替代原来基于小根堆的HeapTimer，用于处理超时连接；
+- 定时器结点直接嵌在连接对象中(侵入式双向链表)，添加、调整、取消都是O(1)，不需要哈希查找，也不需要为每个结点分配回调函数；
+- 第0层256个槽，每槽一个tick；其上三层各64个槽，每层的一个槽覆盖下一层一整圈，结点随时间推移逐层下放(cascade)；
+- tick的粒度可配置，到期时间向上取整到tick，因此不会提前触发；
+- 第0层的槽位有占用位图，GetNextTick据此给出epoll_wait的超时时间；
+- 每个事件循环线程拥有自己的时间轮，时间轮本身不加锁；
+- 当前时间取自TimeService，事件循环每轮只读取一次时钟，因此到期时间以本轮被唤醒的时刻为起点，误差不超过一轮事件处理的耗时；
+*/
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <assert.h>
+#include "timeservice.h"   // 时钟类型与缓存的当前时间
+
+/**
+ * @brief 定时器结点，嵌在需要定时的对象中；
+ * 槽位的链表头也是一个TimerNode(哨兵)，链表是环形的，next为nullptr表示结点不在任何槽中；
+ */
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    uint64_t expire = 0;    // 到期的tick
+    void* data = nullptr;   // 结点所属的对象，回调时据此找回
+
+    bool IsLinked() const { return next != nullptr; }
+};
+
+class TimingWheel {
+public:
+    typedef std::function<void(TimerNode*)> ExpireCallBack;     // 结点到期时调用，结点已经从时间轮中摘下
+
+    TimingWheel(int tickMS, const ExpireCallBack& cb);
+
+    ~TimingWheel();
+
+    void add(TimerNode* node, int timeout);
+
+    /**
+     * @brief 重新设定结点的超时时间，与add相同；
+     */
+    void adjust(TimerNode* node, int timeout) { add(node, timeout); }
+
+    void cancel(TimerNode* node);
+
+    void shrink(int timeout);
+
+    void tick();
+
+    int GetNextTick();
+
+    size_t size() const { return count_; }
+
+private:
+    void Link_(TimerNode* node);
+
+    void Cascade_(int level, int idx);
+
+    int NextRoot_();
+
+    uint64_t NowTick_() const;
+
+    static void Unlink_(TimerNode* node);
+
+    static void PushBack_(TimerNode* head, TimerNode* node);
+
+    static void Splice_(TimerNode* from, TimerNode* to);
+
+    static const int ROOT_BITS = 8;     // 第0层256个槽
+    static const int LEVEL_BITS = 6;    // 其余每层64个槽
+    static const int LEVELS = 3;        // 第0层之上的层数
+    static const int ROOT_SIZE = 1 << ROOT_BITS;
+    static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const uint64_t MAX_TICKS = 1ull << (ROOT_BITS + LEVELS * LEVEL_BITS);  // 能表示的最远到期时间
+
+    TimerNode slots_[ROOT_SIZE + LEVELS * LEVEL_SIZE];  // 所有槽的链表头，第0层在前
+    uint64_t rootBits_[ROOT_SIZE / 64]; // 第0层的占用位图，取消结点时不清除，处理到该槽时再清除
+    uint64_t current_;  // 下一个要处理的tick
+    TimeStamp start_;   // tick 0对应的时间
+    int tickMS_;        // tick的粒度(毫秒)
+    size_t count_;      // 结点数
+    ExpireCallBack cb_;
+};
+
+#endif //TIMING_WHEEL_H
@@ -0,0 +1,139 @@
+/*
+CPU与NUMA拓扑的具体实现
+*/
+#include "cputopology.h"
+
+thread_local int CpuTopology::node_ = -1;
+
+/**
+ * @brief 获取唯一的实例，第一次调用时读取拓扑，应当在任何线程绑核之前调用；
+ */
+CpuTopology* CpuTopology::Instance() {
+    static CpuTopology topology;
+    return &topology;
+}
+
+/**
+ * @brief 构造函数，读取各节点的CPU列表以及进程允许使用的CPU；
+ */
+CpuTopology::CpuTopology() {
+    long cpuCnt = sysconf(_SC_NPROCESSORS_CONF);
+    nodeOf_.assign(cpuCnt > 0 ? cpuCnt : 1, 0);
+    CPU_ZERO(&allowed_);
+    if(sched_getaffinity(0, sizeof(allowed_), &allowed_) != 0) {
+        for(int i = 0; i < CpuCount() && i < CPU_SETSIZE; i++) { CPU_SET(i, &allowed_); }
+    }
+
+    DIR* dir = opendir("/sys/devices/system/node");
+    if(dir) {
+        struct dirent* entry;
+        while((entry = readdir(dir)) != nullptr) {
+            int node = -1;
+            char tail = 0;
+            if(sscanf(entry->d_name, "node%d%c", &node, &tail) != 1 || node < 0) { continue; }
+            char path[64], list[256] = {0};
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+            FILE* fp = fopen(path, "r");
+            if(!fp) { continue; }
+            if(!fgets(list, sizeof(list), fp)) { list[0] = '\0'; }
+            fclose(fp);
+            for(char* p = list; *p; p++) {
+                if(*p == '\n') { *p = '\0'; break; }
+            }
+            if(static_cast<int>(nodeCpus_.size()) <= node) { nodeCpus_.resize(node + 1); }
+            nodeCpus_[node] = list;
+            std::vector<int> cpus;
+            if(!ParseList(list, &cpus)) { continue; }
+            for(int cpu : cpus) {
+                if(cpu < CpuCount()) { nodeOf_[cpu] = node; }
+            }
+        }
+        closedir(dir);
+    }
+    if(nodeCpus_.empty()) {     // 没有NUMA信息，所有CPU视为一个节点
+        nodeCpus_.push_back("0-" + std::to_string(CpuCount() - 1));
+    }
+}
+
+/**
+ * @brief 把调用线程绑定到一个CPU上，并记录所在节点，之后这个线程分配的内存会落在该节点上；
+ * @param cpu CPU编号；
+ * @return 绑定失败(CPU不存在或不在允许范围内)时返回false；
+ */
+bool CpuTopology::Pin(int cpu) {
+    if(cpu < 0 || cpu >= CpuCount() || cpu >= CPU_SETSIZE) { return false; }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) { return false; }
+    node_ = nodeOf_[cpu];
+    return true;
+}
+
+/**
+ * @brief 检查CPU列表中的每个CPU都存在且允许本进程使用；
+ */
+bool CpuTopology::Valid(const std::vector<int>& cpus) const {
+    if(cpus.empty()) { return false; }
+    for(int cpu : cpus) {
+        if(cpu < 0 || cpu >= CpuCount() || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed_)) { return false; }
+    }
+    return true;
+}
+
+/**
+ * @brief 拓扑的文字描述，写入启动日志，如"16 cpus, 2 nodes (node0: 0-7, node1: 8-15)"；
+ */
+std::string CpuTopology::Describe() const {
+    std::string text = std::to_string(CpuCount()) + " cpus, " + std::to_string(NodeCount()) + " nodes (";
+    for(size_t i = 0; i < nodeCpus_.size(); i++) {
+        if(i > 0) { text += ", "; }
+        text += "node" + std::to_string(i) + ": " + (nodeCpus_[i].empty() ? "-" : nodeCpus_[i]);
+    }
+    return text + ")";
+}
+
+/**
+ * @brief n个线程按顺序轮流绑定到cpus上时的分布，如"2/n0 3/n0 10/n1"，写入启动日志；
+ * @param cpus CPU列表；
+ * @param n 线程数；
+ * @param offset 第一个线程使用列表中的第几个；
+ */
+std::string CpuTopology::Placement(const std::vector<int>& cpus, size_t n, size_t offset) const {
+    if(cpus.empty()) { return "unpinned"; }
+    std::string text;
+    for(size_t i = 0; i < n; i++) {
+        int cpu = cpus[(offset + i) % cpus.size()];
+        if(i > 0) { text += " "; }
+        text += std::to_string(cpu) + "/n" + std::to_string(NodeOf(cpu));
+    }
+    return text;
+}
+
+/**
+ * @brief 解析"0-3,8,10-11"形式的CPU列表(与sysfs和taskset的格式相同)；
+ * @param list 列表字符串；
+ * @param cpus 解析结果按书写顺序追加到这里；
+ * @return 格式错误时返回false；
+ */
+bool CpuTopology::ParseList(const char* list, std::vector<int>* cpus) {
+    if(!list || !*list) { return false; }
+    const char* p = list;
+    while(*p) {
+        char* end = nullptr;
+        long lo = strtol(p, &end, 10);
+        if(end == p || lo < 0) { return false; }
+        long hi = lo;
+        p = end;
+        if(*p == '-') {
+            hi = strtol(p + 1, &end, 10);
+            if(end == p + 1 || hi < lo) { return false; }
+            p = end;
+        }
+        if(hi >= CPU_SETSIZE) { return false; }
+        for(long cpu = lo; cpu <= hi; cpu++) { cpus->push_back(static_cast<int>(cpu)); }
+        if(*p == ',') { p++; }
+        else if(*p) { return false; }
+    }
+    return true;
+}
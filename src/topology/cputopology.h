@@ -0,0 +1,67 @@
+/*
+头文件介绍：
+- CPU与NUMA拓扑，启动时从/sys/devices/system/node读取每个节点包含的CPU，读不到时视为只有一个节点；
+- 提供线程绑核(Pin)，绑定后记录当前线程所在的节点；
+- 内存按Linux默认的本地优先策略(first touch)放置：页面落在第一次写入它的线程所在的节点，
+  因此只要由绑定后的线程分配并清零缓冲区，缓冲区就在该线程本地的节点上，不需要链接libnuma；
+*/
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <sched.h>      // sched_getaffinity/CPU_SET
+#include <pthread.h>    // pthread_setaffinity_np
+#include <unistd.h>     // sysconf
+#include <dirent.h>     // 遍历节点目录
+#include <stdio.h>
+#include <stdlib.h>     // strtol
+#include <string>
+#include <vector>
+
+class CpuTopology {
+public:
+    static CpuTopology* Instance();
+
+    /**
+     * @brief 系统的CPU数量(含离线的)；
+     */
+    int CpuCount() const { return static_cast<int>(nodeOf_.size()); }
+
+    /**
+     * @brief NUMA节点数量；
+     */
+    int NodeCount() const { return static_cast<int>(nodeCpus_.size()); }
+
+    /**
+     * @brief CPU所在的节点，不存在的CPU返回-1；
+     */
+    int NodeOf(int cpu) const {
+        return cpu >= 0 && cpu < CpuCount() ? nodeOf_[cpu] : -1;
+    }
+
+    /**
+     * @brief 当前线程绑定的节点，未绑定时返回-1；
+     */
+    static int CurrentNode() { return node_; }
+
+    bool Pin(int cpu);
+
+    bool Valid(const std::vector<int>& cpus) const;
+
+    std::string Describe() const;
+
+    std::string Placement(const std::vector<int>& cpus, size_t n, size_t offset = 0) const;
+
+    static bool ParseList(const char* list, std::vector<int>* cpus);
+
+private:
+    CpuTopology();
+    ~CpuTopology() = default;
+
+    std::vector<int> nodeOf_;   // CPU -> 节点
+    std::vector<std::string> nodeCpus_;     // 每个节点的CPU列表(sysfs中的原文)，下标为节点号
+    cpu_set_t allowed_;     // 启动时进程允许使用的CPU，绑核之前取得
+
+    static thread_local int node_;  // 当前线程绑定的节点
+};
+
+#endif //CPU_TOPOLOGY_H
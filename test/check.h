@@ -0,0 +1,30 @@
+/*
+头文件介绍：
+- 单元测试共用的断言宏，不依赖测试框架；
+- CHECK失败时打印位置并记下失败，测试继续执行，main最后返回CHECK_RESULT()，非0表示失败，由ctest判定；
+*/
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <stdio.h>
+
+static int checkFailures = 0;   // 本测试程序中失败的CHECK数
+
+#define CHECK(cond) do { \
+        if(!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            checkFailures++; \
+        } \
+    } while(0)
+
+#define CHECK_EQ(a, b) do { \
+        long long va_ = static_cast<long long>(a), vb_ = static_cast<long long>(b); \
+        if(va_ != vb_) { \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld vs %lld\n", __FILE__, __LINE__, #a, #b, va_, vb_); \
+            checkFailures++; \
+        } \
+    } while(0)
+
+#define CHECK_RESULT() (checkFailures == 0 ? (printf("all checks passed\n"), 0) : 1)
+
+#endif //TEST_CHECK_H
@@ -0,0 +1,95 @@
+/*
+CoDel排队时间控制器的单元测试，时间全部由参数给出，不依赖时钟：
+- 短暂的突发(区间内最小排队时间低于目标)不算过载；
+- 整个区间都高于目标才判定过载，过载时只丢弃排队超过两倍目标的任务；
+- 区间内出现一次低于目标的排队时间、或者中间空闲超过一个区间，就退出过载；
+- 多个线程同时调用时，排队时间始终低于目标就不会丢弃；
+*/
+#include <thread>
+#include <vector>
+#include "../src/threadpool/codel.h"
+#include "check.h"
+
+static const int64_t TARGET = 5000;      // 5ms
+static const int64_t INTERVAL = 100000;  // 100ms
+
+/**
+ * @brief 在[from, from+INTERVAL)内每隔1ms出队一个排队时间为sojourn的任务；
+ * @return 被丢弃的任务数；
+ */
+static int Feed(CoDel& codel, int64_t from, int64_t sojourn) {
+    int shed = 0;
+    for(int64_t now = from; now < from + INTERVAL; now += 1000) {
+        shed += codel.Shed(sojourn, now);
+    }
+    return shed;
+}
+
+static void TestBurst() {
+    CoDel codel(TARGET, INTERVAL);
+    int64_t now = 1000000;
+    CHECK(!codel.Shed(100000, now));    // 第一个区间还没有结论
+    int shed = 0;
+    for(int i = 1; i < 100; i++) {      // 区间内大多排得很久，但有一次排空
+        shed += codel.Shed(i == 50 ? 1000 : 50000, now + i * 1000);
+    }
+    CHECK_EQ(shed, 0);
+    CHECK(!codel.Shed(50000, now + INTERVAL));
+    CHECK(!codel.IsOverloaded());
+}
+
+static void TestSustained() {
+    CoDel codel(TARGET, INTERVAL);
+    int64_t now = 1000000;
+    CHECK_EQ(Feed(codel, now, TARGET + 1), 0);  // 第一个区间只收集
+    now += INTERVAL;
+    CHECK(!codel.Shed(2 * TARGET, now));    // 切换区间时判定过载，恰好两倍目标不丢
+    CHECK(codel.IsOverloaded());
+    CHECK(codel.Shed(2 * TARGET + 1, now + 1000));
+    CHECK(!codel.Shed(TARGET, now + 2000)); // 没排那么久的照常处理，同时让这个区间的最小值回到目标
+    now += INTERVAL;
+    CHECK(!codel.Shed(50000, now));
+    CHECK(!codel.IsOverloaded());
+
+    CHECK_EQ(Feed(codel, now + 1000, TARGET), 0);   // 恰好等于目标不算积压
+    CHECK(!codel.Shed(50000, now + INTERVAL + 1000));
+    CHECK(!codel.IsOverloaded());
+}
+
+static void TestIdleGap() {
+    CoDel codel(TARGET, INTERVAL);
+    int64_t now = 1000000;
+    Feed(codel, now, 20000);
+    now += INTERVAL;
+    CHECK(codel.Shed(20000, now));
+    CHECK(codel.IsOverloaded());
+    Feed(codel, now + 1000, 20000);     // 积压一直持续
+    CHECK(codel.IsOverloaded());
+    now += 3 * INTERVAL;                // 之后空闲了两个区间，中间没有任务出队
+    CHECK(!codel.Shed(20000, now));
+    CHECK(!codel.IsOverloaded());
+}
+
+static void TestConcurrent() {
+    CoDel codel(TARGET, INTERVAL);
+    std::atomic<int> shed{0};
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([&codel, &shed, t]() {
+            for(int64_t i = 0; i < 200000; i++) {
+                shed += codel.Shed((i + t) % TARGET, 1000000 + i * 10);
+            }
+        });
+    }
+    for(auto& th : threads) { th.join(); }
+    CHECK_EQ(shed.load(), 0);
+    CHECK(!codel.IsOverloaded());
+}
+
+int main() {
+    TestBurst();
+    TestSustained();
+    TestIdleGap();
+    TestConcurrent();
+    return CHECK_RESULT();
+}
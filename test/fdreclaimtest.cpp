@@ -0,0 +1,104 @@
+/*
+已关闭连接的描述符延迟释放(FdReclaimer)的单元测试，按单Reactor模式的顺序模拟一轮事件：
+- 主循环取回一批事件，其中有连接A的挂断事件；处理到它之前，工作线程已经按CloseConn_的步骤关闭了A；
+- 同一批事件里的监听事件accept到新连接B：A的描述符还没释放，B不会复用A的描述符和槽位，A残留的挂断事件只会看到已关闭的A；
+- 对端在释放之前就看到连接关闭；本轮结束释放之后描述符才被复用，复用它的新连接收不到A残留的事件；
+- 对照：立即释放描述符时，新连接马上复用了同一个描述符，也就是同一个槽位；
+*/
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "../src/server/epoller.h"
+#include "../src/server/fdreclaimer.h"
+#include "../src/http/httpconn.h"
+#include "check.h"
+
+static const uint32_t CONN_EVENT = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+
+/**
+ * @brief 以描述符为下标的连接表，与ConnTable一样槽位随描述符复用；
+ */
+static std::vector<HttpConn> table(1024);
+
+/**
+ * @brief 模拟accept：新建一对套接字，服务端一侧放进描述符对应的槽位并注册读事件；
+ * @param peer 对端的描述符；
+ * @return 服务端的描述符；
+ */
+static int Accept(Epoller& ep, int* peer) {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    sockaddr_in addr = {};
+    table[fds[0]].init(fds[0], addr);
+    CHECK(ep.AddFd(fds[0], CONN_EVENT, &table[fds[0]]));
+    *peer = fds[1];
+    return fds[0];
+}
+
+/**
+ * @brief 按WebServer::CloseConn_的步骤关闭连接，描述符交给reclaimer；
+ */
+static void CloseConn(Epoller& ep, FdReclaimer& reclaimer, int fd) {
+    ep.DelFd(fd);
+    table[fd].Close(true);
+    reclaimer.Retire(fd);
+}
+
+static void TestLeftoverEvent() {
+    Epoller ep;
+    FdReclaimer reclaimer;
+    int peerA = -1;
+    int a = Accept(ep, &peerA);
+    close(peerA);                               // 对端挂断
+    CHECK_EQ(ep.Wait(1000), 1);                 // 主循环取回本轮事件
+    HttpConn* stale = static_cast<HttpConn*>(ep.GetEventPtr(0));
+    CHECK(stale == &table[a]);
+    CHECK(ep.GetEvents(0) & (EPOLLRDHUP | EPOLLHUP));
+
+    CloseConn(ep, reclaimer, a);                // 处理到这个事件之前，工作线程关闭了A
+    CHECK_EQ(reclaimer.Size(), 1u);
+
+    int peerB = -1;
+    int b = Accept(ep, &peerB);                 // 本轮的监听事件accept到B
+    CHECK(b != a && peerB != a);                // A的描述符还没释放，不会被复用
+    CHECK(stale->IsClose());                    // 残留的事件落在已关闭的A上，RequestClose_直接忽略
+    CHECK(!table[b].IsClose());
+
+    CloseConn(ep, reclaimer, b);
+    char c = 0;
+    CHECK(read(peerB, &c, 1) == 0);             // 释放之前对端已经看到连接关闭
+
+    reclaimer.Reclaim();                        // 本轮事件处理完，释放描述符
+    CHECK_EQ(reclaimer.Size(), 0u);
+    int peerC = -1;
+    int cfd = Accept(ep, &peerC);
+    CHECK(cfd == a || cfd == b);                // 释放之后描述符才被复用
+    CHECK(!table[cfd].IsClose());
+    CHECK_EQ(ep.Wait(0), 0);                    // 复用描述符的新连接收不到旧连接的事件
+
+    ep.DelFd(cfd);
+    table[cfd].Close();
+    close(peerB);
+    close(peerC);
+}
+
+static void TestImmediateCloseReuses() {
+    Epoller ep;
+    int peerA = -1;
+    int a = Accept(ep, &peerA);
+    ep.DelFd(a);
+    table[a].Close();                           // 立即释放描述符
+    int peerB = -1;
+    int b = Accept(ep, &peerB);
+    CHECK_EQ(b, a);                             // 新连接马上复用了同一个描述符和槽位
+    ep.DelFd(b);
+    table[b].Close();
+    close(peerA);
+    close(peerB);
+}
+
+int main() {
+    TestLeftoverEvent();
+    TestImmediateCloseReuses();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,98 @@
+/*
+HttpConn占用状态与代数的单元测试：
+- 单线程下TryOwn留下的标志在Release时逐次取走，Disown直接放弃；
+- Close使代数加1并清除占用状态，重复Close不再改变代数；
+- 多个线程同时投递事件并争抢占用：同一时刻至多一个占用者，占用者释放前处理完所有留下的标志，没有事件丢失；
+*/
+#include <sys/socket.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+#include "../src/http/httpconn.h"
+#include "check.h"
+
+static void TestFlags() {
+    HttpConn conn;
+    CHECK(conn.TryOwn(HttpConn::PEND_IN));
+    CHECK(!conn.TryOwn(HttpConn::PEND_IN));     // 已被占用，只留下标志
+    CHECK(!conn.TryOwn(HttpConn::PEND_OUT));
+    CHECK(!conn.TryOwn(HttpConn::PEND_IN));     // 同一标志合并
+    CHECK_EQ(conn.Release(), HttpConn::PEND_IN | HttpConn::PEND_OUT);   // 取走标志，仍然占用
+    CHECK(!conn.TryOwn(HttpConn::CLOSE_REQ));
+    CHECK_EQ(conn.Release(), HttpConn::CLOSE_REQ);
+    CHECK_EQ(conn.Release(), 0);                // 没有标志，释放
+    CHECK(conn.TryOwn(HttpConn::PEND_IN));
+    conn.Disown();
+    CHECK(conn.TryOwn(HttpConn::PEND_IN));
+    CHECK_EQ(conn.Release(), 0);
+}
+
+static void TestCloseGen() {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    sockaddr_in addr = {};
+    HttpConn conn;
+    uint32_t gen = conn.Gen();
+    conn.init(fds[0], addr);
+    CHECK(!conn.IsClose());
+    CHECK(conn.TryOwn(HttpConn::PEND_IN));
+    CHECK(!conn.TryOwn(HttpConn::CLOSE_REQ));
+    conn.Close();
+    CHECK(conn.IsClose());
+    CHECK_EQ(conn.Gen(), gen + 1);
+    CHECK(conn.TryOwn(HttpConn::PEND_IN));      // Close清除了占用状态与留下的标志
+    CHECK_EQ(conn.Release(), 0);
+    conn.Close();
+    CHECK_EQ(conn.Gen(), gen + 1);              // 已经关闭，不再递增
+    char c = 0;
+    CHECK(read(fds[1], &c, 1) == 0);            // 对端看到连接关闭
+
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    conn.init(fds[0], addr);                    // 槽位复用给新连接
+    CHECK(!conn.IsClose());
+    conn.Close(true);                           // 描述符由调用者稍后关闭
+    CHECK_EQ(conn.Gen(), gen + 2);
+    CHECK(write(fds[0], &c, 1) == 1);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/**
+ * @brief 每个线程投递事件(submitted加1)后尝试占用，占用成功的线程处理事件直到Release返回0；
+ * 占用者每处理一轮，就把已处理的数量推进到当时的submitted，结束时必须等于投递总数；
+ */
+static void TestConcurrentOwn() {
+    const int THREADS = 4;
+    const int ROUNDS = 200000;
+    HttpConn conn;
+    std::atomic<int> submitted{0};
+    std::atomic<int> owners{0};     // 当前的占用者数量，不能超过1
+    std::atomic<bool> overlap{false};
+    int handled = 0;                // 只由占用者读写，由占用状态的acq_rel保证可见
+    std::vector<std::thread> threads;
+    for(int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&]() {
+            for(int i = 0; i < ROUNDS; i++) {
+                submitted.fetch_add(1, std::memory_order_relaxed);
+                if(!conn.TryOwn(HttpConn::PEND_IN)) { continue; }
+                do {
+                    if(owners.fetch_add(1) != 0) { overlap = true; }
+                    handled = submitted.load();
+                    owners.fetch_sub(1);
+                } while(conn.Release() != 0);
+            }
+        });
+    }
+    for(auto& th : threads) { th.join(); }
+    CHECK(!overlap);
+    CHECK_EQ(handled, THREADS * ROUNDS);
+    CHECK(conn.TryOwn(HttpConn::PEND_IN));      // 最后一个占用者已经释放
+    CHECK_EQ(conn.Release(), 0);
+}
+
+int main() {
+    TestFlags();
+    TestCloseGen();
+    TestConcurrentOwn();
+    return CHECK_RESULT();
+}
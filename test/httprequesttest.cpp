@@ -0,0 +1,141 @@
+/*
+HttpRequest::Scan与parse的单元测试：
+- 长连接上连续发送的多个请求(pipelining)各自的长度，以及parse只取走第一个请求；
+- 请求被拆成任意多次读取时(包括空行被拆开)，增量查找的结果与一次读全相同；
+- 头部过长431、请求体过长413、Content-Length无效(非数字、溢出、多次出现且不同)400；
+*/
+#include <string>
+#include "../src/http/httprequest.h"
+#include "check.h"
+
+/**
+ * @brief 把数据一次追加进缓冲区后Scan；
+ * @return Scan的返回值，requestLen与errCode通过参数带回；
+ */
+static HttpRequest::PARSE_STATE ScanAll(const std::string& data, size_t* requestLen, int* errCode) {
+    HttpRequest request;
+    Buffer buff;
+    buff.Append(data);
+    *requestLen = 0;
+    return request.Scan(buff, requestLen, errCode);
+}
+
+static void TestPipelining() {
+    const std::string get = "GET /index HTTP/1.1\r\nHost: x\r\nConnection: keep-alive\r\n\r\n";
+    const std::string post = "POST /login HTTP/1.1\r\nHost: x\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: 25\r\n\r\nuser=ab&password=cd\r\n\r\nxx";
+    HttpRequest request;
+    Buffer buff;
+    buff.Append(get + post + get.substr(0, 10));   // 最后一个请求只到了一部分
+    size_t len = 0;
+    int err = -1;
+    CHECK(request.Scan(buff, &len, &err) == HttpRequest::FINISH);
+    CHECK_EQ(err, 0);
+    CHECK_EQ(len, get.size());
+    CHECK(request.parse(buff, len));
+    CHECK(request.path() == "/index.html");
+    CHECK(request.IsKeepAlive());
+    CHECK_EQ(buff.ReadableBytes(), post.size() + 10);
+
+    request.Init();
+    CHECK(request.Scan(buff, &len, &err) == HttpRequest::FINISH);
+    CHECK_EQ(len, post.size());     // 请求体中的空行不会被当作下一个请求的开头
+    CHECK(request.parse(buff, len));
+    CHECK(request.method() == "POST");
+    CHECK(request.GetPost("user") == "ab");
+    CHECK_EQ(buff.ReadableBytes(), 10);
+
+    request.Init();
+    CHECK(request.Scan(buff, &len, &err) == HttpRequest::HEADERS);
+    buff.Append(get.substr(10));
+    CHECK(request.Scan(buff, &len, &err) == HttpRequest::FINISH);
+    CHECK_EQ(len, get.size());
+}
+
+/**
+ * @brief 以各种方式把请求拆成两次或逐字节读入，每次追加后Scan，结果必须与一次读全相同；
+ */
+static void TestSplitReads() {
+    const std::string req = "POST /register HTTP/1.1\r\nHost: x\r\nContent-Length: 7\r\n\r\nabc\r\ndeNEXT";
+    const size_t total = req.size() - 4;    // 末尾的NEXT属于下一个请求
+    const size_t header = total - 7;
+    for(size_t cut = 1; cut < req.size(); cut++) {
+        HttpRequest request;
+        Buffer buff;
+        size_t len = 0;
+        int err = -1;
+        buff.Append(req.substr(0, cut));
+        HttpRequest::PARSE_STATE state = request.Scan(buff, &len, &err);
+        if(cut < header) {
+            CHECK(state == HttpRequest::HEADERS);
+        } else if(cut < total) {
+            CHECK(state == HttpRequest::BODY);
+        } else {
+            CHECK(state == HttpRequest::FINISH);
+        }
+        buff.Append(req.substr(cut));
+        CHECK(request.Scan(buff, &len, &err) == HttpRequest::FINISH);
+        CHECK_EQ(err, 0);
+        CHECK_EQ(len, total);
+    }
+    HttpRequest request;    // 逐字节读入，空行的四个字节分别在四次读取中
+    Buffer buff;
+    size_t len = 0;
+    int err = -1;
+    int finished = 0;
+    for(size_t i = 0; i < total; i++) {
+        buff.Append(req.data() + i, 1);
+        if(request.Scan(buff, &len, &err) == HttpRequest::FINISH) { finished++; }
+    }
+    CHECK_EQ(finished, 1);
+    CHECK_EQ(len, total);
+}
+
+static void TestLimits() {
+    HttpRequest::maxHeaderBytes = 64;
+    HttpRequest::maxBodyBytes = 100;
+    size_t len = 0;
+    int err = -1;
+    const std::string line = "GET / HTTP/1.1\r\n";
+
+    CHECK(ScanAll(line + "Host: x\r\n\r\n", &len, &err) == HttpRequest::FINISH);
+    CHECK_EQ(err, 0);
+    // 空行还没到，已经超过上限
+    CHECK(ScanAll(line + "Cookie: " + std::string(60, 'a'), &len, &err) == HttpRequest::FINISH);
+    CHECK_EQ(err, 431);
+    // 上限以内还没有空行，继续等待
+    CHECK(ScanAll(line + "Cookie: a", &len, &err) == HttpRequest::HEADERS);
+    CHECK_EQ(err, 0);
+    // 空行在一次读取中到达，但头部整体超过上限
+    CHECK(ScanAll(line + "Cookie: " + std::string(40, 'a') + "\r\n\r\n", &len, &err) == HttpRequest::FINISH);
+    CHECK_EQ(err, 431);
+
+    CHECK(ScanAll(line + "Content-Length: 100\r\n\r\n", &len, &err) == HttpRequest::BODY);
+    CHECK_EQ(err, 0);
+    CHECK(ScanAll(line + "Content-Length: 101\r\n\r\n", &len, &err) == HttpRequest::FINISH);
+    CHECK_EQ(err, 413);
+
+    HttpRequest::maxHeaderBytes = 0;    // 只检查Content-Length本身
+    HttpRequest::maxBodyBytes = 0;
+    const char* bad[] = {
+        "Content-Length: 12a",
+        "Content-Length: -1",
+        "Content-Length:",
+        "Content-Length: 1 2",
+        "Content-Length: 99999999999999999999999",  // 溢出
+        "Content-Length: 3\r\nContent-Length: 4",   // 多次出现且不同
+    };
+    for(const char* header : bad) {
+        CHECK(ScanAll(line + header + "\r\n\r\n", &len, &err) == HttpRequest::FINISH);
+        CHECK_EQ(err, 400);
+    }
+    CHECK(ScanAll(line + "content-length:\t3 \r\nContent-Length: 3\r\n\r\nabc", &len, &err) == HttpRequest::FINISH);
+    CHECK_EQ(err, 0);
+    CHECK_EQ(len, line.size() + 44);
+}
+
+int main() {
+    TestPipelining();
+    TestSplitReads();
+    TestLimits();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,144 @@
+/*
+MpmcRing的单元测试：
+- 容量、满与空、多圈回绕后的先进先出顺序；
+- TryPushN在剩余空间不足时只入队前面的部分；
+- 只能移动的元素，以及析构时销毁残留的元素；
+- 多个生产者(单个与批量入队混合)与多个消费者同时运行：每个元素恰好出队一次，同一生产者的元素按入队顺序出队；
+*/
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../src/threadpool/mpmcring.h"
+#include "check.h"
+
+static void TestFifo() {
+    MpmcRing<int> ring(8);
+    CHECK_EQ(ring.Capacity(), 8);
+    CHECK(ring.Empty());
+    int item = -1;
+    CHECK(!ring.TryPop(&item));
+    int next = 0, expect = 0;
+    for(int lap = 0; lap < 5; lap++) {     // 每圈放入5个、取出5个，下标不断回绕
+        for(int i = 0; i < 5; i++) { int v = next++; CHECK(ring.TryPush(v)); }
+        CHECK_EQ(ring.Size(), 5);
+        for(int i = 0; i < 5; i++) {
+            CHECK(ring.TryPop(&item));
+            CHECK_EQ(item, expect++);
+        }
+    }
+    for(int i = 0; i < 8; i++) { int v = i; CHECK(ring.TryPush(v)); }
+    int extra = 100;
+    CHECK(!ring.TryPush(extra));    // 满了，元素保持不变
+    CHECK_EQ(extra, 100);
+    CHECK_EQ(ring.Size(), 8);
+    for(int i = 0; i < 8; i++) { CHECK(ring.TryPop(&item)); CHECK_EQ(item, i); }
+    CHECK(ring.Empty());
+}
+
+static void TestPushN() {
+    MpmcRing<int> ring(8);
+    int items[10];
+    for(int i = 0; i < 10; i++) { items[i] = i; }
+    CHECK_EQ(ring.TryPushN(items, 0), 0);
+    CHECK_EQ(ring.TryPushN(items, 3), 3);
+    CHECK_EQ(ring.TryPushN(items + 3, 7), 5);   // 只剩5个空位
+    CHECK_EQ(ring.TryPushN(items + 8, 2), 0);
+    int item = -1;
+    CHECK(ring.TryPop(&item) && item == 0);
+    CHECK(ring.TryPop(&item) && item == 1);
+    CHECK_EQ(ring.TryPushN(items + 8, 2), 2);   // 跨过数组末尾回绕
+    for(int i = 2; i < 10; i++) { CHECK(ring.TryPop(&item)); CHECK_EQ(item, i); }
+    CHECK(!ring.TryPop(&item));
+}
+
+/**
+ * @brief 统计存活对象数的元素类型；
+ */
+struct Counted {
+    static int alive;
+    std::unique_ptr<int> value;
+
+    Counted() { alive++; }
+    explicit Counted(int v): value(new int(v)) { alive++; }
+    Counted(Counted&& other): value(std::move(other.value)) { alive++; }
+    Counted& operator=(Counted&& other) { value = std::move(other.value); return *this; }
+    ~Counted() { alive--; }
+};
+
+int Counted::alive = 0;
+
+static void TestMoveOnlyAndDestroy() {
+    {
+        MpmcRing<Counted> ring(4);
+        Counted a(1), b(2), c(3);
+        CHECK(ring.TryPush(a) && ring.TryPush(b) && ring.TryPush(c));
+        CHECK(!a.value && !b.value);    // 成功时被移走
+        Counted out;
+        CHECK(ring.TryPop(&out));
+        CHECK(out.value && *out.value == 1);
+        CHECK_EQ(Counted::alive, 4 + 2);    // a、b、c、out与队列中的两个
+    }
+    CHECK_EQ(Counted::alive, 0);    // 队列析构时销毁了残留的元素
+}
+
+/**
+ * @brief 每个生产者放入(生产者编号, 序号)，一半单个入队一半批量入队；
+ * 消费者记下每个元素出现的次数，并检查自己看到的同一生产者的序号是递增的；
+ */
+static void TestConcurrent() {
+    const int PRODUCERS = 3;
+    const int CONSUMERS = 3;
+    const int PER = 200000;
+    MpmcRing<uint64_t> ring(64);
+    std::vector<std::atomic<uint8_t>> seen(PRODUCERS * PER);
+    std::atomic<int> popped{0};
+    std::atomic<bool> disorder{false};
+    std::vector<std::thread> threads;
+    for(int p = 0; p < PRODUCERS; p++) {
+        threads.emplace_back([&ring, p]() {
+            uint64_t batch[8];
+            for(int i = 0; i < PER; ) {
+                if(p % 2 == 0) {
+                    uint64_t v = static_cast<uint64_t>(p) << 32 | i;
+                    if(ring.TryPush(v)) { i++; } else { std::this_thread::yield(); }
+                } else {
+                    int n = PER - i < 8 ? PER - i : 8;
+                    for(int k = 0; k < n; k++) { batch[k] = static_cast<uint64_t>(p) << 32 | (i + k); }
+                    size_t done = ring.TryPushN(batch, n);
+                    if(done == 0) { std::this_thread::yield(); }
+                    i += done;
+                }
+            }
+        });
+    }
+    for(int c = 0; c < CONSUMERS; c++) {
+        threads.emplace_back([&]() {
+            int64_t last[PRODUCERS];
+            for(auto& v : last) { v = -1; }
+            uint64_t v;
+            while(popped.load(std::memory_order_relaxed) < PRODUCERS * PER) {
+                if(!ring.TryPop(&v)) { std::this_thread::yield(); continue; }
+                int p = v >> 32;
+                int64_t i = v & 0xffffffff;
+                if(i <= last[p]) { disorder = true; }
+                last[p] = i;
+                seen[p * PER + i].fetch_add(1, std::memory_order_relaxed);
+                popped.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for(auto& th : threads) { th.join(); }
+    int once = 0;
+    for(auto& s : seen) { once += s.load() == 1; }
+    CHECK_EQ(once, PRODUCERS * PER);
+    CHECK(!disorder);
+    CHECK(ring.Empty());
+}
+
+int main() {
+    TestFifo();
+    TestPushN();
+    TestMoveOnlyAndDestroy();
+    TestConcurrent();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,223 @@
+/*
+时间轮的单元测试：
+- 用TimeService::Advance驱动时间，不需要真的等待，几百万个tick也能瞬间走完；
+- 覆盖各层之间的下放(cascade)、调整与取消、回调中重新添加、GetNextTick、shrink以及析构时摘下结点；
+- 最后用固定种子的随机操作与逐个结点的期望到期时间对照；
+*/
+#include <vector>
+#include <random>
+#include "../src/timer/timingwheel.h"
+#include "check.h"
+
+static TimeStamp base;  // 测试开始时的时刻，时间轮的tick 0
+
+/**
+ * @brief 把时间推进到base之后ms毫秒；
+ */
+static void SetTime(int64_t ms) {
+    TimeService::Advance(base + MS(ms));
+}
+
+/**
+ * @brief 到期的结点都记在这里，连同到期时的时刻；
+ */
+struct Fired {
+    std::vector<TimerNode*> nodes;
+    std::vector<int64_t> at;
+    int64_t now = 0;
+};
+
+static void TestExpiryAndCascade() {
+    Fired fired;
+    SetTime(0);
+    TimingWheel wheel(1, [&fired](TimerNode* node) { fired.nodes.push_back(node); fired.at.push_back(fired.now); });
+    // 每层的边界两侧各放一个，第1层从256开始，第2层从16384开始，第3层从1048576开始
+    const int64_t timeouts[] = { 5, 255, 256, 300, 16383, 16384, 20000, 1048575, 1048576, 1500000 };
+    const int n = sizeof(timeouts) / sizeof(timeouts[0]);
+    TimerNode nodes[n];
+    for(int i = 0; i < n; i++) { wheel.add(&nodes[i], static_cast<int>(timeouts[i])); }
+    CHECK_EQ(wheel.size(), n);
+    for(int i = 0; i < n; i++) {
+        fired.now = timeouts[i] - 1;    // 到期前一毫秒不触发
+        SetTime(fired.now);
+        wheel.tick();
+        CHECK_EQ(fired.nodes.size(), i);
+        fired.now = timeouts[i];        // 到期时恰好触发，不早也不晚
+        SetTime(fired.now);
+        wheel.tick();
+        CHECK_EQ(fired.nodes.size(), i + 1);
+        if(static_cast<int>(fired.nodes.size()) == i + 1) {
+            CHECK(fired.nodes[i] == &nodes[i]);
+            CHECK_EQ(fired.at[i], timeouts[i]);
+        }
+        CHECK(!nodes[i].IsLinked());
+    }
+    CHECK_EQ(wheel.size(), 0);
+}
+
+static void TestAdjustAndCancel() {
+    Fired fired;
+    SetTime(0);
+    TimingWheel wheel(10, [&fired](TimerNode* node) { fired.nodes.push_back(node); });
+    TimerNode a, b, c;
+    wheel.add(&a, 100);
+    wheel.add(&b, 100);
+    wheel.add(&c, 5000);
+    wheel.adjust(&a, 3000);     // 推后，跨到上一层
+    wheel.adjust(&c, 50);       // 提前，从上一层回到第0层
+    wheel.cancel(&b);
+    wheel.cancel(&b);           // 重复取消不影响计数
+    CHECK_EQ(wheel.size(), 2);
+    SetTime(45);                // 粒度10ms，50ms向上取整到第5个tick
+    wheel.tick();
+    CHECK(fired.nodes.empty());
+    SetTime(50);
+    wheel.tick();
+    CHECK(fired.nodes.size() == 1 && fired.nodes[0] == &c);
+    SetTime(2999);
+    wheel.tick();
+    CHECK_EQ(fired.nodes.size(), 1);
+    SetTime(3000);
+    wheel.tick();
+    CHECK(fired.nodes.size() == 2 && fired.nodes[1] == &a);
+    CHECK_EQ(wheel.size(), 0);
+}
+
+static void TestCallbackReAddAndCancel() {
+    SetTime(0);
+    TimerNode a, b, c;
+    int countA = 0, countB = 0, countC = 0;
+    TimingWheel* self = nullptr;
+    TimingWheel wheel(1, [&](TimerNode* node) {
+        if(node == &a) {    // 像OnTimeout_那样重新设定
+            if(++countA < 3) { self->add(&a, 10); }
+            self->cancel(&b);   // 取消同一批中还没回调的结点
+        } else if(node == &b) {
+            countB++;
+        } else if(node == &c) {
+            countC++;
+        }
+    });
+    self = &wheel;
+    wheel.add(&a, 10);
+    wheel.add(&b, 10);
+    wheel.add(&c, 10);
+    SetTime(10);
+    wheel.tick();
+    CHECK_EQ(countA, 1);
+    CHECK_EQ(countB, 0);
+    CHECK_EQ(countC, 1);
+    CHECK(a.IsLinked() && !b.IsLinked());
+    SetTime(100);               // 回调中重新添加以缓存的当前时间为起点，即110ms
+    wheel.tick();
+    CHECK_EQ(countA, 2);
+    SetTime(110);
+    wheel.tick();
+    CHECK_EQ(countA, 3);
+    CHECK_EQ(wheel.size(), 0);
+}
+
+static void TestNextTick() {
+    SetTime(0);
+    TimingWheel wheel(10, [](TimerNode*) {});
+    CHECK_EQ(wheel.GetNextTick(), -1);
+    TimerNode a, b;
+    wheel.add(&a, 95);          // 第10个tick
+    CHECK_EQ(wheel.GetNextTick(), 100);
+    SetTime(30);
+    CHECK_EQ(wheel.GetNextTick(), 70);
+    wheel.add(&b, 5000);        // 在上层，GetNextTick不越过下一次下放的位置
+    wheel.cancel(&a);
+    int next = wheel.GetNextTick();
+    CHECK(next > 0 && next <= 5000 - 30);
+    SetTime(5029);              // 从30ms起算，b在第503个tick到期
+    CHECK(b.IsLinked());
+    SetTime(5030);
+    CHECK_EQ(wheel.GetNextTick(), -1);
+    CHECK(!b.IsLinked());
+}
+
+static void TestShrinkAndDestroy() {
+    Fired fired;
+    SetTime(0);
+    TimerNode far1, far2, near;
+    {
+        TimingWheel wheel(1, [&fired](TimerNode* node) { fired.nodes.push_back(node); });
+        wheel.add(&far1, 60000);
+        wheel.add(&far2, 2000000);
+        wheel.add(&near, 10);
+        wheel.shrink(100);      // 热升级排空：最多再等100ms
+        SetTime(10);
+        wheel.tick();
+        CHECK(fired.nodes.size() == 1 && fired.nodes[0] == &near);
+        SetTime(100);
+        wheel.tick();
+        CHECK_EQ(fired.nodes.size(), 3);
+        wheel.add(&far1, 1000);
+        wheel.add(&far2, 100000);
+        CHECK(far1.IsLinked() && far2.IsLinked());
+    }
+    // 时间轮先于结点析构(如连接表)，析构时要把结点摘下
+    CHECK(!far1.IsLinked() && !far2.IsLinked());
+}
+
+/**
+ * @brief 随机添加、调整、取消，按不规则的步长推进，结点必须恰好在期望的时刻之后的第一次tick中到期；
+ */
+static void TestRandom() {
+    const int N = 2000;
+    std::mt19937 rng(12345);
+    std::vector<TimerNode> nodes(N);
+    std::vector<int64_t> expect(N, -1);     // 期望的到期时刻，-1表示不在时间轮中
+    int64_t now = 0;
+    bool ok = true;
+    SetTime(0);
+    TimingWheel wheel(1, [&](TimerNode* node) {
+        size_t i = node - nodes.data();
+        if(expect[i] < 0 || expect[i] > now) { ok = false; }    // 取消的结点触发了，或者提前触发
+        expect[i] = -1;
+    });
+    for(int step = 0; step < 20000; step++) {
+        int i = rng() % N;
+        int op = rng() % 4;
+        if(op < 2) {
+            int timeout = rng() % 4 == 0 ? rng() % 2000000 : rng() % 3000;
+            wheel.add(&nodes[i], timeout);
+            expect[i] = now + timeout;
+        } else if(op == 2) {
+            wheel.cancel(&nodes[i]);
+            expect[i] = -1;
+        } else {
+            now += rng() % 700;
+            SetTime(now);
+            wheel.tick();
+            for(int k = 0; k < N; k++) {
+                if(expect[k] >= 0 && expect[k] <= now) { ok = false; }  // 到期了却没有触发
+            }
+        }
+    }
+    size_t linked = 0;
+    for(int k = 0; k < N; k++) { linked += expect[k] >= 0; }
+    CHECK_EQ(wheel.size(), linked);
+    now += 2000000;
+    SetTime(now);
+    wheel.tick();
+    CHECK_EQ(wheel.size(), 0);
+    CHECK(ok);
+}
+
+int main() {
+    base = Clock::now();
+    TestExpiryAndCascade();
+    base += MS(10000000);   // 每个用例从更晚的时刻开始，缓存的时间只能往前推进
+    TestAdjustAndCancel();
+    base += MS(10000000);
+    TestCallbackReAddAndCancel();
+    base += MS(10000000);
+    TestNextTick();
+    base += MS(10000000);
+    TestShrinkAndDestroy();
+    base += MS(10000000);
+    TestRandom();
+    return CHECK_RESULT();
+}